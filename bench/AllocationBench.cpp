@@ -0,0 +1,80 @@
+#include "../include/Simulation.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+using std::string;
+
+/*
+Counts calls to the global operator new made by Simulation::step once the world has warmed up,
+serially and with a thread pool, with and without compact history. Facilities are stored by
+value in per-plan arrays and the per-tick buffers are reused, so a step with compact history
+does not allocate; without it, what is left comes from the plans' histories growing.
+
+Usage: bin/alloc_bench [num_plans] [num_steps]
+*/
+
+static std::atomic<long> allocations(0);
+
+void *operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    void *memory = std::malloc(size > 0 ? size : 1);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void operator delete(void *memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept {
+    std::free(memory);
+}
+
+static string writeConfig(int numPlans) {
+    string path = "/tmp/alloc_bench_" + std::to_string(numPlans) + ".txt";
+    std::ofstream config(path);
+    const char *policies[] = {"eco", "bal", "sus", "nve"};
+    for (int i = 0; i < numPlans; i++) {
+        config << "settlement S" << i << " " << i % 3 << "\n";
+    }
+    config << "facility Hospital 0 5 5 3 2\nfacility School 0 4 4 2 2\nfacility Park 0 3 3 1 3\n";
+    config << "facility Factory 1 5 2 5 1\nfacility Market 1 4 3 3 2\nfacility Bank 1 4 2 5 0\n";
+    config << "facility SolarFarm 2 4 2 2 4\nfacility WildlifeReserve 2 4 2 1 4\nfacility Recycling 2 5 3 1 5\n";
+    for (int i = 0; i < numPlans; i++) {
+        config << "plan S" << i << " " << policies[i % 4] << "\n";
+    }
+    return path;
+}
+
+int main(int argc, char** argv) {
+    int numPlans = argc > 1 ? std::atoi(argv[1]) : 10000;
+    int numSteps = argc > 2 ? std::atoi(argv[2]) : 200;
+    string path = writeConfig(numPlans);
+
+    printf("threads,compact_history,plans,steps,allocations_per_step,ms_per_step\n");
+    for (bool compactHistory : {false, true}) {
+        for (int threads : {1, 4}) {
+            Simulation simulation(path);
+            simulation.setNumThreads(threads);
+            simulation.setCompactHistory(compactHistory);
+            for (int i = 0; i < numSteps; i++) { //Warm up: buffers reach their working size
+                simulation.step();
+            }
+            long before = allocations.load();
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < numSteps; i++) {
+                simulation.step();
+            }
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            printf("%d,%d,%d,%d,%.2f,%.3f\n", threads, compactHistory, numPlans, numSteps, (double)(allocations.load() - before) / numSteps, ms / numSteps);
+        }
+    }
+    std::remove(path.c_str());
+    return 0;
+}
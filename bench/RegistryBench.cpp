@@ -0,0 +1,76 @@
+#include "../include/Simulation.h"
+#include "../include/Settlement.h"
+#include "../include/Plan.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+using std::string;
+
+/*
+Scaling benchmark for settlement and plan lookups.
+For growing world sizes it loads a generated config and measures the config load time and the
+average latency of getSettlement, isSettlementExists and getPlan, the lookups behind the
+plan, planStatus, changePolicy and settlement commands. Per-command latency should stay flat.
+
+Usage: bin/registry_bench [max_settlements]
+*/
+
+static const int LOOKUPS = 1000000;
+
+static double nanosSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+static string writeConfig(int numSettlements) {
+    string path = "/tmp/registry_bench_" + std::to_string(numSettlements) + ".txt";
+    std::ofstream config(path);
+    for (int i = 0; i < numSettlements; i++) {
+        config << "settlement S" << i << " " << i % 3 << "\n";
+    }
+    config << "facility Market 1 4 3 3 2\n";
+    for (int i = 0; i < numSettlements; i++) {
+        config << "plan S" << i << " eco\n";
+    }
+    return path;
+}
+
+int main(int argc, char** argv) {
+    int maxSettlements = argc > 1 ? std::stoi(argv[1]) : 1000000;
+    std::streambuf *console = std::cout.rdbuf();
+
+    printf("settlements,load_ms,getSettlement_ns,isSettlementExists_ns,getPlan_ns\n");
+    for (int n = 1000; n <= maxSettlements; n *= 10) {
+        string path = writeConfig(n);
+        std::cout.rdbuf(nullptr); //The simulation is chatty while loading
+        auto start = std::chrono::steady_clock::now();
+        Simulation simulation(path);
+        double loadMs = nanosSince(start) / 1e6;
+        std::cout.rdbuf(console);
+
+        long checksum = 0;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < LOOKUPS; i++) {
+            checksum += simulation.getSettlement("S" + std::to_string((int)((i * 7919LL) % n))).getName().size();
+        }
+        double getSettlementNs = nanosSince(start) / LOOKUPS;
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < LOOKUPS; i++) {
+            checksum += simulation.isSettlementExists("S" + std::to_string((int)((i * 7919LL) % (2 * n))));
+        }
+        double existsNs = nanosSince(start) / LOOKUPS;
+
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < LOOKUPS; i++) {
+            checksum += simulation.getPlan((int)((i * 7919LL) % n)).getPlanId();
+        }
+        double getPlanNs = nanosSince(start) / LOOKUPS;
+
+        printf("%d,%.1f,%.1f,%.1f,%.1f\n", n, loadMs, getSettlementNs, existsNs, getPlanNs);
+        fprintf(stderr, "checksum %ld\n", checksum);
+        std::remove(path.c_str());
+    }
+    return 0;
+}
@@ -0,0 +1,238 @@
+#include "../include/Simulation.h"
+#include "../include/SelectionPolicy.h"
+#include "../include/FacilityCatalog.h"
+#include "../include/Auxiliary.h"
+#include "../include/LineReader.h"
+#include "../include/Log.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+using std::string;
+using std::vector;
+
+/*
+Benchmark suite for the hot paths, built at -O2 and run by make bench:
+    step          Simulation::step against the number of plans and the catalog size
+    select        selectFacility of each policy against the catalog size
+    parse, load   Auxiliary::parseArguments per line and the config load rate
+    backup        createBackup and getRestore latency
+    dispatch      per-command cost of Simulation::start in batch mode (status, policy, log and
+                  unknown commands, no stepping)
+Results are printed one per line as CSV (benchmark,parameters,value,unit), or as a JSON array
+with --json, so the output of two commits can be compared directly. --quick runs the small
+sizes only.
+
+Usage: bin/bench [--json] [--quick]
+*/
+
+struct BenchResult {
+    string benchmark;
+    string parameters;
+    double value;
+    string unit;
+};
+
+static vector<BenchResult> results;
+static volatile long sink; //Keeps results of the measured calls alive
+
+static void report(const string &benchmark, const string &parameters, double value, const string &unit) {
+    results.push_back({benchmark, parameters, value, unit});
+    fprintf(stderr, "%s %s: %.2f %s\n", benchmark.c_str(), parameters.c_str(), value, unit.c_str());
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static const char *POLICIES[] = {"nve", "bal", "eco", "sus"}; //As the config file names them
+
+static FacilityType facilityType(int i) {
+    return FacilityType("Facility" + std::to_string(i), static_cast<FacilityCategory>(i % 3), i % 5 + 1, i % 4, (i / 3) % 5, (i / 7) % 4);
+}
+
+static string writeConfig(int numPlans, int numTypes) {
+    string path = "/tmp/simulation_bench_" + std::to_string(numPlans) + "_" + std::to_string(numTypes) + ".txt";
+    std::ofstream config(path);
+    for (int i = 0; i < numPlans; i++) {
+        config << "settlement S" << i << " " << i % 3 << "\n";
+    }
+    for (int i = 0; i < numTypes; i++) {
+        FacilityType type = facilityType(i);
+        config << "facility " << type.getName() << " " << (int)type.getCategory() << " " << type.getCost() << " "
+               << type.getLifeQualityScore() << " " << type.getEconomyScore() << " " << type.getEnvironmentScore() << "\n";
+    }
+    for (int i = 0; i < numPlans; i++) {
+        config << "plan S" << i << " " << POLICIES[i % 4] << "\n";
+    }
+    return path;
+}
+
+static string params(int numPlans, int numTypes) {
+    return "plans=" + std::to_string(numPlans) + ";types=" + std::to_string(numTypes);
+}
+
+static void benchStep(int numPlans, int numTypes, int numSteps) {
+    string path = writeConfig(numPlans, numTypes);
+    Simulation simulation(path);
+    for (int i = 0; i < 20; i++) { //Warm up: per-step buffers reach their working size
+        simulation.step();
+    }
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < numSteps; i++) {
+        simulation.step();
+    }
+    double seconds = secondsSince(start);
+    report("step", params(numPlans, numTypes), seconds * 1e3 / numSteps, "ms/step");
+    report("step", params(numPlans, numTypes), (double)numPlans * numSteps / seconds, "plan-steps/s");
+    std::remove(path.c_str());
+}
+
+static void benchSelect(int numTypes, int numCalls) {
+    FacilityCatalog catalog;
+    for (int i = 0; i < numTypes; i++) {
+        catalog.add(facilityType(i));
+    }
+    PlanPolicy policies[] = {NaiveSelection(), BalancedSelection(0, 0, 0), EconomySelection(), SustainabilitySelection()};
+    for (int p = 0; p < 4; p++) {
+        long checksum = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < numCalls; i++) {
+            checksum += policies[p].selectFacility(catalog).getCost();
+        }
+        double seconds = secondsSince(start);
+        sink = checksum;
+        report("select", "policy=" + string(POLICIES[p]) + ";types=" + std::to_string(numTypes), seconds * 1e9 / numCalls, "ns/call");
+    }
+}
+
+static void benchParse(int numLines) {
+    vector<string> lines;
+    for (int i = 0; i < numLines; i++) {
+        lines.push_back(i % 2 == 0 ? "settlement S" + std::to_string(i) + " 1" : "facility Facility" + std::to_string(i) + " 1 4 3 2 1");
+    }
+    long checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const string &line : lines) {
+        checksum += Auxiliary::parseArguments(line).size();
+    }
+    double seconds = secondsSince(start);
+    sink = checksum;
+    report("parse", "lines=" + std::to_string(numLines), seconds * 1e9 / numLines, "ns/line");
+}
+
+static void benchLoad(int numPlans, int numTypes) {
+    string path = writeConfig(numPlans, numTypes);
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    double megabytes = file.tellg() / 1e6;
+    auto start = std::chrono::steady_clock::now();
+    Simulation simulation(path);
+    double seconds = secondsSince(start);
+    report("load", params(numPlans, numTypes), megabytes / seconds, "MB/s");
+    report("load", params(numPlans, numTypes), (2.0 * numPlans + numTypes) / seconds, "lines/s");
+    std::remove(path.c_str());
+}
+
+static void benchBackup(int numPlans, int numTypes, int numRounds) {
+    string path = writeConfig(numPlans, numTypes);
+    Simulation simulation(path);
+    for (int i = 0; i < 20; i++) {
+        simulation.step();
+    }
+    double backupSeconds = 0, restoreSeconds = 0;
+    for (int i = 0; i < numRounds; i++) {
+        auto start = std::chrono::steady_clock::now();
+        simulation.createBackup();
+        backupSeconds += secondsSince(start);
+        simulation.step(); //Every plan changes, so the restore has a whole world to swap back
+        start = std::chrono::steady_clock::now();
+        simulation.getRestore();
+        restoreSeconds += secondsSince(start);
+    }
+    report("backup", params(numPlans, numTypes), backupSeconds * 1e6 / numRounds, "us/createBackup");
+    report("backup", params(numPlans, numTypes), restoreSeconds * 1e6 / numRounds, "us/getRestore");
+    std::remove(path.c_str());
+}
+
+static void benchDispatch(int numPlans, int numCommands) {
+    string path = writeConfig(numPlans, 9);
+    string scriptPath = "/tmp/simulation_bench_commands.txt";
+    {
+        std::ofstream script(scriptPath);
+        for (int i = 0; i < numCommands; i++) {
+            switch (i % 4) {
+                case 0: script << "planStatus " << i % numPlans << "\n"; break;
+                case 1: script << "changePolicy " << i % numPlans << " " << POLICIES[i % 3] << "\n"; break;
+                case 2: script << "log -1 1\n"; break;
+                default: script << "unknownCommand\n"; break;
+            }
+        }
+    }
+    Simulation simulation(path);
+    int fd = open(scriptPath.c_str(), O_RDONLY);
+    LineReader commands(fd);
+    auto start = std::chrono::steady_clock::now();
+    simulation.start(commands);
+    double seconds = secondsSince(start);
+    close(fd);
+    report("dispatch", "plans=" + std::to_string(numPlans) + ";commands=" + std::to_string(numCommands), seconds * 1e9 / numCommands, "ns/command");
+    std::remove(scriptPath.c_str());
+    std::remove(path.c_str());
+}
+
+static void printResults(bool json) {
+    if (json) {
+        printf("[\n");
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchResult &result = results[i];
+            printf("  {\"benchmark\": \"%s\", \"parameters\": \"%s\", \"value\": %.4f, \"unit\": \"%s\"}%s\n", result.benchmark.c_str(),
+                   result.parameters.c_str(), result.value, result.unit.c_str(), i + 1 < results.size() ? "," : "");
+        }
+        printf("]\n");
+    } else {
+        printf("benchmark,parameters,value,unit\n");
+        for (const BenchResult &result : results) {
+            printf("%s,%s,%.4f,%s\n", result.benchmark.c_str(), result.parameters.c_str(), result.value, result.unit.c_str());
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    bool json = false, quick = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (std::strcmp(argv[i], "--quick") == 0) {
+            quick = true;
+        } else {
+            fprintf(stderr, "usage: bench [--json] [--quick]\n");
+            return 1;
+        }
+    }
+    Log::setLevel(LogLevel::ERROR);
+    std::streambuf *console = std::cout.rdbuf(nullptr); //The simulation's own output is not measured
+
+    int maxPlans = quick ? 10000 : 100000;
+    for (int numPlans = 1000; numPlans <= maxPlans; numPlans *= 10) {
+        for (int numTypes : {9, 90}) {
+            benchStep(numPlans, numTypes, numPlans >= 100000 ? 20 : 100);
+        }
+    }
+    for (int numTypes : {9, 90, 900}) {
+        benchSelect(numTypes, 1000000);
+    }
+    benchParse(1000000);
+    benchLoad(maxPlans, 90);
+    benchBackup(quick ? 1000 : 10000, 9, 100);
+    benchDispatch(1000, quick ? 100000 : 1000000);
+
+    std::cout.rdbuf(console);
+    printResults(json);
+    Log::shutdown();
+    return 0;
+}
@@ -0,0 +1,131 @@
+#include "../include/Auxiliary.h"
+#include "../include/MappedFile.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+using std::string;
+
+/*
+Config parsing microbenchmark: Auxiliary::parseArguments + std::stoi over std::getline
+against Auxiliary::tokenize + Auxiliary::parseInt over a mapped file.
+A plain newline scan of the mapped file is the I/O bound the tokenizer should approach.
+Each pass adds up the numeric fields so the three can be checked against each other.
+
+Usage: bin/tokenizer_bench [num_lines]
+*/
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static string writeConfig(long numLines) {
+    string path = "/tmp/tokenizer_bench_" + std::to_string(numLines) + ".txt";
+    std::ofstream config(path);
+    for (long i = 0; i < numLines; i++) {
+        switch (i % 4) {
+            case 0: config << "settlement Settlement" << i << " " << i % 3 << "\n"; break;
+            case 1: config << "facility Facility" << i << " " << i % 3 << " " << i % 7 + 1 << " " << i % 5 << " " << i % 4 << " " << i % 6 << "\n"; break;
+            case 2: config << "plan Settlement" << i - 2 << " eco\n"; break;
+            default: config << "# comment line " << i << "\n"; break;
+        }
+    }
+    return path;
+}
+
+static long sumNumbers(const std::vector<string> &args) {
+    long sum = 0;
+    for (size_t i = 2; i < args.size() && args[0] != "plan"; i++) {
+        sum += std::stoi(args[i]);
+    }
+    return sum;
+}
+
+static long parseWithStreams(const string &path, long &lines) {
+    std::ifstream config(path);
+    string line;
+    long sum = 0;
+    while (std::getline(config, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        sum += sumNumbers(Auxiliary::parseArguments(line));
+        lines++;
+    }
+    return sum;
+}
+
+static long parseInPlace(const string &path, long &lines) {
+    MappedFile config;
+    config.open(path);
+    const char *position = config.data();
+    const char *end = position + config.size();
+    std::string_view args[8];
+    long sum = 0;
+    while (position < end) {
+        const char *lineEnd = static_cast<const char*>(std::memchr(position, '\n', end - position));
+        if (lineEnd == nullptr) {
+            lineEnd = end;
+        }
+        std::string_view line(position, lineEnd - position);
+        position = lineEnd + 1;
+        if (line.empty() || line[0] == '#') continue;
+        int numArgs = Auxiliary::tokenize(line, args, 8);
+        for (int i = 2; i < numArgs && args[0] != "plan"; i++) {
+            int value = 0;
+            Auxiliary::parseInt(args[i], value);
+            sum += value;
+        }
+        lines++;
+    }
+    return sum;
+}
+
+static long scanLines(const string &path, long &lines) {
+    MappedFile config;
+    config.open(path);
+    const char *position = config.data();
+    const char *end = position + config.size();
+    long bytes = 0;
+    while (position < end) {
+        const char *lineEnd = static_cast<const char*>(std::memchr(position, '\n', end - position));
+        if (lineEnd == nullptr) {
+            lineEnd = end;
+        }
+        bytes += lineEnd - position;
+        position = lineEnd + 1;
+        lines++;
+    }
+    return bytes;
+}
+
+int main(int argc, char** argv) {
+    long numLines = argc > 1 ? std::stol(argv[1]) : 10000000;
+    string path = writeConfig(numLines);
+    MappedFile config;
+    config.open(path);
+    double megabytes = config.size() / 1e6;
+
+    printf("parser,lines,seconds,MB_per_s,checksum\n");
+    long lines = 0;
+    auto start = std::chrono::steady_clock::now();
+    long checksum = scanLines(path, lines);
+    double seconds = secondsSince(start);
+    printf("newline_scan,%ld,%.3f,%.0f,%ld\n", lines, seconds, megabytes / seconds, checksum);
+
+    lines = 0;
+    start = std::chrono::steady_clock::now();
+    checksum = parseWithStreams(path, lines);
+    seconds = secondsSince(start);
+    printf("parseArguments+stoi,%ld,%.3f,%.0f,%ld\n", lines, seconds, megabytes / seconds, checksum);
+
+    lines = 0;
+    start = std::chrono::steady_clock::now();
+    checksum = parseInPlace(path, lines);
+    seconds = secondsSince(start);
+    printf("tokenize+parseInt,%ld,%.3f,%.0f,%ld\n", lines, seconds, megabytes / seconds, checksum);
+
+    std::remove(path.c_str());
+    return 0;
+}
@@ -2,6 +2,7 @@
 #include <string>
 #include <vector>
 #include "Simulation.h"
+#include "ActionJournal.h"
 enum class SettlementType;
 enum class FacilityCategory;
 
@@ -16,6 +17,7 @@ class BaseAction{
         virtual void act(Simulation& simulation)=0;
         virtual const string toString() const=0;
         virtual BaseAction* clone() const = 0;
+        virtual ActionRecord toRecord(ActionJournal &journal) const = 0;
         virtual ~BaseAction() = default;
 
     protected:
@@ -35,6 +37,7 @@ class SimulateStep : public BaseAction {
         void act(Simulation &simulation) override;
         const string toString() const override;
         SimulateStep *clone() const override;
+        ActionRecord toRecord(ActionJournal &journal) const override;
     private:
         const int numOfSteps;
 };
@@ -45,6 +48,7 @@ class AddPlan : public BaseAction {
         void act(Simulation &simulation) override;
         const string toString() const override;
         AddPlan *clone() const override;
+        ActionRecord toRecord(ActionJournal &journal) const override;
     private:
         const string settlementName;
         const string selectionPolicy;
@@ -56,6 +60,7 @@ class AddSettlement : public BaseAction {
         AddSettlement(const string &settlementName,SettlementType settlementType);
         void act(Simulation &simulation) override;
         AddSettlement *clone() const override;
+        ActionRecord toRecord(ActionJournal &journal) const override;
         const string toString() const override;
     private:
         const string settlementName;
@@ -69,6 +74,7 @@ class AddFacility : public BaseAction {
         AddFacility(const string &facilityName, const FacilityCategory facilityCategory, const int price, const int lifeQualityScore, const int economyScore, const int environmentScore);
         void act(Simulation &simulation) override;
         AddFacility *clone() const override;
+        ActionRecord toRecord(ActionJournal &journal) const override;
         const string toString() const override;
     private:
         const string facilityName;
@@ -85,17 +91,48 @@ class PrintPlanStatus: public BaseAction {
         PrintPlanStatus(int planId);
         void act(Simulation &simulation) override;
         PrintPlanStatus *clone() const override;
+        ActionRecord toRecord(ActionJournal &journal) const override;
         const string toString() const override;
     private:
         const int planId;
 };
 
+// Score totals of all plans, of a settlement's plans or of the plans of a settlement type
+class PrintAggregate: public BaseAction {
+    public:
+        PrintAggregate();
+        PrintAggregate(const string &settlementName);
+        PrintAggregate(SettlementType settlementType);
+        void act(Simulation &simulation) override;
+        PrintAggregate *clone() const override;
+        ActionRecord toRecord(ActionJournal &journal) const override;
+        const string toString() const override;
+    private:
+        const string settlementName; //Empty unless by settlement
+        const bool byType;
+        const int settlementType; //Any value parsed, checked when acting
+};
+
+// The k best plans by a PlanRanking metric, best first
+class PrintTopPlans: public BaseAction {
+    public:
+        PrintTopPlans(int k, const string &metric);
+        void act(Simulation &simulation) override;
+        PrintTopPlans *clone() const override;
+        ActionRecord toRecord(ActionJournal &journal) const override;
+        const string toString() const override;
+    private:
+        const int k;
+        const string metric;
+};
+
 
 class ChangePlanPolicy : public BaseAction {
     public:
         ChangePlanPolicy(const int planId, const string &newPolicy);
         void act(Simulation &simulation) override;
         ChangePlanPolicy *clone() const override;
+        ActionRecord toRecord(ActionJournal &journal) const override;
         const string toString() const override;
     private:
         const int planId;
@@ -106,10 +143,14 @@ class ChangePlanPolicy : public BaseAction {
 class PrintActionsLog : public BaseAction {
     public:
         PrintActionsLog();
+        PrintActionsLog(int first, int count);
         void act(Simulation &simulation) override;
         PrintActionsLog *clone() const override;
+        ActionRecord toRecord(ActionJournal &journal) const override;
         const string toString() const override;
     private:
+        const int first; //First entry to print, negative to count from the end
+        const int count; //-1 for all
 };
 
 class Close : public BaseAction {
@@ -117,6 +158,7 @@ class Close : public BaseAction {
         Close();
         void act(Simulation &simulation) override;
         Close *clone() const override;
+        ActionRecord toRecord(ActionJournal &journal) const override;
         const string toString() const override;
     private:
 };
@@ -124,18 +166,24 @@ class Close : public BaseAction {
 class BackupSimulation : public BaseAction {
     public:
         BackupSimulation();
+        BackupSimulation(const string &filePath);
         void act(Simulation &simulation) override;
         BackupSimulation *clone() const override;
+        ActionRecord toRecord(ActionJournal &journal) const override;
         const string toString() const override;
     private:
+        const string filePath; //Checkpoint file, empty for the in-memory backup
 };
 
 
 class RestoreSimulation : public BaseAction {
     public:
         RestoreSimulation();
+        RestoreSimulation(const string &filePath);
         void act(Simulation &simulation) override;
         RestoreSimulation *clone() const override;
+        ActionRecord toRecord(ActionJournal &journal) const override;
         const string toString() const override;
     private:
+        const string filePath; //Checkpoint file, empty for the in-memory backup
 };
\ No newline at end of file
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+using std::string;
+using std::vector;
+
+class BaseAction;
+
+enum class ActionKind : uint8_t {
+    ADD_SETTLEMENT,
+    ADD_FACILITY,
+    ADD_PLAN,
+    SIMULATE_STEP,
+    PRINT_PLAN_STATUS,
+    CHANGE_PLAN_POLICY,
+    PRINT_ACTIONS_LOG,
+    CLOSE,
+    BACKUP,
+    RESTORE,
+    PRINT_AGGREGATE,
+    PRINT_TOP_PLANS,
+};
+
+// One logged command. Strings are stored as ids into the journal's dictionary (-1 for none).
+struct ActionRecord {
+    ActionKind kind;
+    uint8_t status; //ActionStatus
+    uint16_t reserved;
+    uint32_t repeat; //Identical consecutive commands folded into this record
+    int32_t args[6];
+};
+
+/*
+The actions log. Commands are kept as fixed-size ActionRecords in a ring buffer, an identical
+command following another only bumps its repeat count, and names are stored once in a
+dictionary, so a long session costs a constant amount of memory per distinct command.
+With a capacity set, the oldest records are dropped once the ring is full.
+The text of an entry is only produced when the log is printed (see describe).
+
+Entries are addressed by their position among the retained commands, oldest first, with
+repeated commands counted one by one.
+*/
+class ActionJournal {
+    public:
+        ActionJournal();
+        void setCapacity(size_t maxRecords); //0 for unbounded
+        void append(const ActionRecord &record);
+        int intern(std::string_view text);
+        const string &getString(int id) const;
+        int getNumStrings() const;
+        long long size() const; //Retained commands
+        long long getNumLogged() const; //Commands ever logged, including dropped ones
+        void truncate(long long numLogged);
+        void print(long long first, long long count, std::ostream &out) const;
+        BaseAction *makeAction(const ActionRecord &record) const;
+        string describe(const ActionRecord &record) const;
+        size_t getNumRecords() const;
+        const ActionRecord &getRecord(size_t index) const; //index-th retained record, oldest first
+
+    private:
+        vector<ActionRecord> records;
+        size_t head; //Oldest record when the ring is full
+        size_t numRecords;
+        size_t capacity;
+        long long numCommands;
+        long long numLogged;
+        vector<string> strings;
+        std::unordered_map<string, int> stringIds;
+};
@@ -1,10 +1,18 @@
 #pragma once
 #include <iostream>
+#include <cstdint>
 #include <vector>
 #include <sstream>
 #include <string>
+#include <string_view>
 
 class Auxiliary{
     public:
         static std::vector<std::string> parseArguments(const std::string& line);
+        static int tokenize(std::string_view line, std::string_view *arguments, int maxArguments);
+        static bool parseInt(std::string_view text, int &value);
+        static void setBatchOutput(bool enabled);
+        static bool writeAll(int fd, const void *data, size_t size); //Retries short and interrupted writes
+        static bool syncParentDirectory(const std::string &path); //Makes a rename or a new file in it durable
+        static uint64_t fnv1a(const void *data, size_t size, uint64_t hash = 14695981039346656037ULL); //Pass the previous result to continue a hash
 };
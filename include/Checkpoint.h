@@ -0,0 +1,105 @@
+#pragma once
+#include <cstdint>
+
+/*
+On-disk checkpoint format written by Simulation::saveCheckpoint and read by
+Simulation::loadCheckpoint (both in src/Checkpoint.cpp).
+
+The file is a fixed header followed by arrays of fixed-size little-endian records, each section
+starting on an 8-byte boundary at the offset recorded in the header. A loader maps the file and
+reads the records in place instead of parsing it. The header carries a format version and an
+FNV-1a checksum of everything after the header; the header's own fields are checked against the
+file size before any record is read. A checkpoint is written to a temporary file next to its path,
+synced, and renamed into place, and the directory is synced after the rename.
+
+Plans refer to settlements and facility types by index. Each plan owns a contiguous range of
+operational facility runs (type and count, in completion order), pending facilities and per-type
+counts of the operational facilities kept only as counts.
+*/
+
+static const char CHECKPOINT_MAGIC[8] = {'S', 'P', 'L', 'C', 'K', 'P', 'T', '\0'};
+static const uint32_t CHECKPOINT_VERSION = 3;
+
+enum CheckpointSection {
+    SECTION_STRINGS,
+    SECTION_SETTLEMENTS,
+    SECTION_FACILITY_TYPES,
+    SECTION_PLANS,
+    SECTION_OPERATIONAL,
+    SECTION_PENDING,
+    SECTION_SKIPPED,
+    NUM_SECTIONS,
+};
+
+enum CheckpointPolicy {
+    POLICY_NAIVE,
+    POLICY_BALANCED,
+    POLICY_ECONOMY,
+    POLICY_SUSTAINABILITY,
+};
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t headerSize;
+    uint64_t fileSize;
+    uint64_t checksum;
+    int32_t planCounter;
+    int32_t currentTick;
+    uint64_t sectionOffset[NUM_SECTIONS];
+    uint64_t sectionCount[NUM_SECTIONS]; //Bytes for SECTION_STRINGS, records otherwise
+};
+
+struct SettlementRecord {
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    int32_t type;
+    int32_t reserved;
+};
+
+struct FacilityTypeRecord {
+    uint32_t nameOffset;
+    uint32_t nameLength;
+    int32_t category;
+    int32_t price;
+    int32_t lifeQualityScore;
+    int32_t economyScore;
+    int32_t environmentScore;
+    int32_t reserved;
+};
+
+struct PlanRecord {
+    int32_t planId;
+    int32_t settlement;
+    int32_t policy;
+    int32_t policyState[3]; //lastSelectedIndex, or the BalancedSelection target scores
+    int32_t status;
+    int32_t reserved;
+    int64_t lifeQualityScore;
+    int64_t economyScore;
+    int64_t environmentScore;
+    uint32_t firstOperational;
+    uint32_t numOperational;
+    uint32_t firstPending;
+    uint32_t numPending;
+    uint32_t firstSkipped;
+    uint32_t numSkipped;
+};
+
+struct PendingRecord {
+    int32_t typeId;
+    int32_t completionTick;
+};
+
+// An operational run
+struct FacilityCountRecord {
+    int32_t typeId;
+    int32_t count;
+};
+
+// A per-type count in SECTION_SKIPPED
+struct SkippedRecord {
+    int32_t typeId;
+    int32_t reserved;
+    int64_t count;
+};
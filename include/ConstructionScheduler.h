@@ -0,0 +1,23 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <functional>
+#include <utility>
+using std::vector;
+
+/*
+Min-heap of pending facility completions keyed by the tick at which they become OPERATIONAL.
+Each entry only remembers the plan (by its index in Simulation::plans); the plan itself knows
+which of its facilities are due. A tick in which nothing completes costs a single peek.
+*/
+class ConstructionScheduler {
+    public:
+        ConstructionScheduler();
+        void schedule(int completionTick, int planIndex);
+        void popDue(int currentTick, vector<int> &planIndexes);
+        int size() const;
+        void clear();
+
+    private:
+        std::priority_queue<std::pair<int, int>, vector<std::pair<int, int>>, std::greater<std::pair<int, int>>> pending;
+};
@@ -1,4 +1,5 @@
 #pragma once
+#include <climits>
 #include <string>
 #include <vector>
 using std::string;
@@ -34,21 +35,29 @@ class FacilityType {
         const int environment_score;
 };
 
-class Facility: public FacilityType {
+// Ticks are ints and the simulation never steps past MAX_TICK. A facility that would complete
+// later is given MAX_TICK + 1, a tick that is never reached
+static const int MAX_TICK = INT_MAX - 1;
+
+/*
+A facility built by a plan. Its name, category, cost and scores are those of its type in the
+FacilityCatalog and its settlement is the plan's, so only the type id and the tick construction
+ends at are stored; whether it is operational follows from the plan list holding it.
+*/
+class Facility {
     public:
-        Facility(const string &name, const string &settlementName, int category, const int price, const int lifeQuality_score, const int economy_score, const int environment_score);
-        Facility(const FacilityType &type, const string &settlementName);
-        const string &getSettlementName() const;
-        const int getTimeLeft() const;
-        FacilityStatus step();
-        void setStatus(FacilityStatus status);
-        const FacilityStatus& getStatus() const;
-        const string toString() const;
-        string statusToString() const;
+        Facility(int typeId, int completionTick);
+        int getTypeId() const;
+        int getCompletionTick() const; //Simulation tick at which the facility becomes OPERATIONAL
+        void setCompletionTick(int tick);
 
     private:
-        const string settlementName;
-        FacilityStatus status;
-        int timeLeft;
-        static FacilityCategory intToFacilityCategory(int category);
-};
\ No newline at end of file
+        int typeId; //Index of the facility type in the simulation's facility options
+        int completionTick;
+};
+
+// Consecutive operational facilities of the same type, in the order they were completed
+struct FacilityRun {
+    int typeId;
+    int count;
+};
@@ -0,0 +1,43 @@
+#pragma once
+#include <vector>
+#include "Facility.h"
+using std::vector;
+
+/*
+The facility types a simulation can build, in the order they were added.
+Next to the types the catalog keeps, per FacilityCategory, the ascending list of catalog
+indexes in that category, so category based policies find their next facility without
+scanning the whole catalog, and a structure-of-arrays copy of the scores for the vectorized
+BalancedSelection kernel.
+*/
+class FacilityCatalog {
+    public:
+        FacilityCatalog();
+        FacilityCatalog(const FacilityCatalog &other);
+        FacilityCatalog &operator=(const FacilityCatalog &other);
+        bool add(const FacilityType &type); //False, and nothing added, for a category outside FacilityCategory
+        void clear();
+        void truncate(int newSize);
+        int size() const {
+            return types.size();
+        }
+        bool empty() const {
+            return types.empty();
+        }
+        const FacilityType &operator[](int index) const {
+            return types[index];
+        }
+        vector<FacilityType>::const_iterator begin() const;
+        vector<FacilityType>::const_iterator end() const;
+        const vector<int> &getCategoryIndexes(FacilityCategory category) const;
+        int nextInCategory(FacilityCategory category, int fromIndex, int &cursor) const;
+        int mostBalanced(int lifeQualityScore, int economyScore, int environmentScore) const;
+
+    private:
+        vector<FacilityType> types;
+        vector<int> categoryIndexes[3];
+        //Structure-of-arrays copy of the scores, scanned by mostBalanced
+        vector<int> lifeQualityScores;
+        vector<int> economyScores;
+        vector<int> environmentScores;
+};
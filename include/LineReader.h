@@ -0,0 +1,24 @@
+#pragma once
+#include <string_view>
+#include <vector>
+#include <cstddef>
+using std::vector;
+
+/*
+Reads lines from a file descriptor through a large buffer, handing them out as views into it.
+Used by batch mode to read command scripts (or piped stdin) without a copy per line.
+A line is valid until the next call to next().
+*/
+class LineReader {
+    public:
+        LineReader(int fd);
+        bool next(std::string_view &line); //False at end of input
+    
+    private:
+        bool fill();
+        int fd;
+        vector<char> buffer;
+        size_t begin; //Start of the unread data in buffer
+        size_t end; //End of the unread data in buffer
+        bool atEnd;
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include <atomic>
+#include <sstream>
+#include <string>
+#include <string_view>
+using std::string;
+
+/*
+Leveled diagnostic logging, kept apart from the simulation's output (std::cout).
+Messages are formatted on the calling thread and handed to a background thread that writes them
+to stderr in large chunks, so logging never blocks on the terminal.
+
+Use the macros: LOG_TRACE(...) and LOG_DEBUG(...) are for the step and selection paths and
+compile to nothing when LOG_COMPILE_LEVEL is above their level (release builds, see the makefile
+release target); LOG_INFO(...) and LOG_ERROR(...) are always compiled. Whatever is compiled in is
+filtered at runtime by Log::setLevel (bin/main --log-level, or the logLevel command).
+
+    LOG_DEBUG("Plan " << planId << " selected " << facility.getName());
+*/
+
+enum class LogLevel {
+    TRACE, DEBUG, INFO, ERROR, OFF
+};
+
+#ifndef LOG_COMPILE_LEVEL
+#ifdef NDEBUG
+#define LOG_COMPILE_LEVEL 2 //INFO
+#else
+#define LOG_COMPILE_LEVEL 0 //TRACE
+#endif
+#endif
+
+class Log {
+    public:
+        static void setLevel(LogLevel level);
+        static LogLevel getLevel();
+        static bool isEnabled(LogLevel level) {
+            return (int)level >= currentLevel.load(std::memory_order_relaxed);
+        }
+        static bool parseLevel(std::string_view name, LogLevel &level);
+        static void write(LogLevel level, const string &message);
+        static void flush(); //Returns once everything logged so far is written
+        static void shutdown(); //Flushes and stops the writer thread
+
+    private:
+        static std::atomic<int> currentLevel;
+};
+
+// Collects one message and hands it to Log::write when it goes out of scope
+class LogLine {
+    public:
+        LogLine(LogLevel level);
+        ~LogLine();
+        template <typename T>
+        LogLine &operator<<(const T &value) {
+            stream << value;
+            return *this;
+        }
+
+    private:
+        LogLevel level;
+        std::ostringstream &stream;
+};
+
+#define LOG_AT(level, message) do { if (Log::isEnabled(level)) { LogLine(level) << message; } } while (0)
+
+#if LOG_COMPILE_LEVEL <= 0
+#define LOG_TRACE(message) LOG_AT(LogLevel::TRACE, message)
+#else
+#define LOG_TRACE(message) do {} while (0)
+#endif
+
+#if LOG_COMPILE_LEVEL <= 1
+#define LOG_DEBUG(message) LOG_AT(LogLevel::DEBUG, message)
+#else
+#define LOG_DEBUG(message) do {} while (0)
+#endif
+
+#define LOG_INFO(message) LOG_AT(LogLevel::INFO, message)
+#define LOG_ERROR(message) LOG_AT(LogLevel::ERROR, message)
@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+#include <cstddef>
+using std::string;
+
+/*
+A file mapped read-only into memory, unmapped when the object goes away.
+Used to read configuration files and checkpoints in place, without copying them into buffers.
+*/
+class MappedFile {
+    public:
+        MappedFile();
+        ~MappedFile();
+        MappedFile(const MappedFile &other) = delete;
+        MappedFile &operator=(const MappedFile &other) = delete;
+        bool open(const string &filePath); //False if the file cannot be opened or mapped
+        const char *data() const;
+        size_t size() const;
+
+    private:
+        void unmap();
+        void *mapping;
+        size_t length;
+};
@@ -1,9 +1,11 @@
 #pragma once
 #include <vector>
+#include <ostream>
 #include "Plan.h"
 #include "Settlement.h"
 #include "SelectionPolicy.h"
 #include "Facility.h"
+#include "FacilityCatalog.h"
 using std::vector;
 
 enum class PlanStatus {
@@ -13,30 +15,55 @@ enum class PlanStatus {
 
 class Plan {
     public:
-        Plan(const int planId, const Settlement &settlement, SelectionPolicy *selectionPolicy, const vector<FacilityType> &facilityOptions);
-        ~Plan();
-        Plan &operator=(const Plan &other)=delete;
-        const int getlifeQualityScore() const;
-        const int getEconomyScore() const;
-        const int getEnvironmentScore() const;
-        void setSelectionPolicy(SelectionPolicy *selectionPolicy);
+        Plan(const int planId, const Settlement &settlement, const PlanPolicy &selectionPolicy, const FacilityCatalog &facilityOptions);
+        Plan(const Plan &other) = default;
+        Plan(Plan &&other) = default;
+        Plan &operator=(const Plan &other) = default;
+        Plan &operator=(Plan &&other) = default;
+        const long long getlifeQualityScore() const;
+        const long long getEconomyScore() const;
+        const long long getEnvironmentScore() const;
+        void setSelectionPolicy(const PlanPolicy &selectionPolicy);
+        const PlanPolicy &getSelectionPolicy() const;
         const PlanStatus getStatus() const;
-        void step();
-        void printStatus();
-        const vector<Facility*> &getFacilities() const;
-        void addFacility(Facility* facility);
+        int step(int currentTick);
+        int step(int currentTick, int selectedTypeId);
+        template <typename Policy>
+        int stepWith(int currentTick, int &selectedTypeId);
+        void completeFacilities(int currentTick);
+        void updateStatus();
+        void fastForward(int currentTick, int targetTick);
+        void printStatus(std::ostream &out);
+        const vector<FacilityRun> &getOperationalRuns() const;
+        const vector<Facility> &getUnderConstruction() const;
+        const vector<long long> &getSkippedOperational() const;
+        const PlanStatus getLastStatus() const;
+        void restoreState(PlanStatus status, long long lifeQualityScore, long long economyScore, long long environmentScore);
+        void restoreFacility(int typeId, FacilityStatus status, int completionTick);
+        void restoreRun(int typeId, int count);
+        void restoreSkipped(int typeId, long long count);
+        void setCompactHistory(bool compact);
+        void addFacility(const Facility &facility);
         const string toString() const;
         const int getPlanId() const;
         const Settlement &getSettlement() const;
+        void rebind(const Settlement &settlement, const FacilityCatalog &facilityOptions);
 
     private:
         int plan_id;
-        const Settlement &settlement;
-        SelectionPolicy *selectionPolicy; //What happens if we change this to a reference?
+        const Settlement *settlement; //Owned by the simulation, see rebind
+        PlanPolicy selectionPolicy; //Inline, copied with the plan
         PlanStatus status;
-        vector<Facility*> facilities;
-        vector<Facility*> underConstruction;
-        const vector<FacilityType> &facilityOptions;
-        int life_quality_score, economy_score, environment_score;
+        vector<FacilityRun> operationalRuns; //Operational facilities, run-length encoded
+        vector<Facility> underConstruction;
+        vector<long long> skippedOperational; //Per facility type, operational facilities not kept in operationalRuns
+        bool compactHistory; //Fold operationalRuns into skippedOperational, keeping only counts
+        const FacilityCatalog *facilityOptions;
+        long long life_quality_score, economy_score, environment_score; //A long horizon outgrows an int
         std::string statusToString() const;
+        void cycleSignature(int currentTick, vector<int> &signature) const;
+        void moveCompleted(int currentTick);
+        void advance(int currentTick);
+        void appendRun(int typeId, int count);
+        void foldRuns();
 };
\ No newline at end of file
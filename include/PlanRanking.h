@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "PlanStore.h"
+using std::string;
+using std::vector;
+
+enum class RankMetric {
+    LIFE_QUALITY,
+    ECONOMY,
+    ENVIRONMENT,
+    SPREAD, //Highest minus lowest of the three scores, lower ranks first
+};
+
+static const int NUM_RANK_METRICS = 4;
+
+/*
+Plans ranked by each metric, for top. Every metric keeps an indexed binary heap of plan ids (the
+best plan at the root, ties going to the lower id) together with each plan's position in it, so
+a plan whose scores changed is moved in O(log n).
+Stepping only marks the plans it changed, in every heap's own list; a heap catches up when its
+metric is asked for, in O(c log n) for the c plans changed since then, and the other metrics'
+heaps are left alone. A heap is built again from scratch (O(n)) when more than half the plans
+changed since it was last used, or the plans were replaced (restore, checkpoint load,
+fast-forward). The k best are then read off the heap in O(k log k).
+*/
+class PlanRanking {
+    public:
+        PlanRanking();
+        void markChanged(int planId);
+        void invalidate();
+        void top(int k, RankMetric metric, const PlanStore &plans, vector<int> &planIds);
+        static bool parseMetric(std::string_view name, RankMetric &metric);
+        static const char *metricName(RankMetric metric);
+        static long long value(const Plan &plan, RankMetric metric);
+
+    private:
+        struct Heap {
+            vector<int> planIds;
+            vector<int> positions; //By plan id
+            vector<int64_t> keys; //By plan id, higher is better
+            vector<int> changed; //Plans whose key is out of date
+            vector<uint8_t> isChanged; //By plan id
+            bool valid;
+        };
+        Heap heaps[NUM_RANK_METRICS];
+        static void refresh(Heap &heap, RankMetric metric, const PlanStore &plans);
+        static void rebuild(Heap &heap, RankMetric metric, const PlanStore &plans);
+        static bool better(const Heap &heap, int planA, int planB);
+        static void siftUp(Heap &heap, int position);
+        static void siftDown(Heap &heap, int position);
+        static void place(Heap &heap, int position, int planId);
+};
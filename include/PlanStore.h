@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include "Plan.h"
+using std::vector;
+
+/*
+The plans of a simulation, indexed by plan id. Slots live in fixed-size chunks that never move,
+so adding plans never relocates the slots already there and growing to millions of plans only
+grows the short list of chunks.
+Copies share chunks and plans copy-on-write: copying a store (for a backup) copies one pointer
+per chunk, and writable(index) first copies the plan's chunk if another store shares it, then
+the plan itself if another chunk does.
+*/
+class PlanStore {
+    public:
+        PlanStore();
+        int size() const;
+        bool empty() const;
+        void reserve(int numPlans);
+        void add(Plan plan);
+        const Plan &operator[](int index) const {
+            return *chunks[index >> CHUNK_BITS]->plans[index & CHUNK_MASK];
+        }
+        Plan &writable(int index);
+        void unshareChunks(); //After this, writable can be called concurrently for different plans
+
+    private:
+        static const int CHUNK_BITS = 10;
+        static const int CHUNK_SIZE = 1 << CHUNK_BITS;
+        static const int CHUNK_MASK = CHUNK_SIZE - 1;
+        struct Chunk {
+            std::shared_ptr<Plan> plans[CHUNK_SIZE];
+        };
+        vector<std::shared_ptr<Chunk>> chunks;
+        int numPlans;
+        Chunk &writableChunk(int chunkIndex);
+};
@@ -0,0 +1,37 @@
+#pragma once
+#include <vector>
+#include "Settlement.h"
+#include "Facility.h"
+using std::vector;
+
+struct ScoreTotal {
+    int numPlans;
+    long long lifeQualityScore;
+    long long economyScore;
+    long long environmentScore;
+};
+
+/*
+Running sums of the plans' scores per settlement (by handle, its position in
+Simulation::settlements), per settlement type and over all plans. A plan's scores only grow when
+it starts building a facility, so the simulation adds that facility's scores here as it goes and
+a query never looks at the plans.
+*/
+class ScoreTotals {
+    public:
+        ScoreTotals();
+        void addPlan(int settlementHandle, SettlementType type);
+        void addFacility(int settlementHandle, SettlementType type, const FacilityType &facility);
+        void addScores(int settlementHandle, SettlementType type, long long lifeQualityScore, long long economyScore, long long environmentScore);
+        void clear();
+        const ScoreTotal &getGlobal() const;
+        const ScoreTotal &getByType(SettlementType type) const;
+        ScoreTotal getBySettlement(int settlementHandle) const;
+
+    private:
+        ScoreTotal global;
+        ScoreTotal byType[3]; //By SettlementType
+        vector<ScoreTotal> bySettlement; //Grown on demand, settlements without plans may be missing
+        ScoreTotal &settlementTotal(int settlementHandle);
+        ScoreTotal *typeTotal(SettlementType type); //nullptr for a type outside SettlementType
+};
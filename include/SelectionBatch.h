@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include "PlanStore.h"
+#include "FacilityCatalog.h"
+using std::vector;
+
+/*
+Selection stage run once per tick before the plans are stepped.
+Plans that need a facility this tick are grouped by policy kind (getGroup), so the step loop
+runs each group with the policy type known. BalancedSelection plans are further grouped by
+their target scores and each group is resolved with a single pass of the vectorized catalog
+kernel, instead of one catalog scan per plan.
+The grouping works in buffers kept across ticks, so a tick does not allocate.
+*/
+class SelectionBatch {
+    public:
+        void select(const PlanStore &plans, const FacilityCatalog &catalog, vector<int> &choices);
+        const vector<int> &getGroup(PolicyKind kind) const; //Indexes of the plans of the last select
+
+    private:
+        struct BalancedRequest {
+            int lifeQualityScore;
+            int economyScore;
+            int environmentScore;
+            int planIndex;
+        };
+        vector<BalancedRequest> balancedRequests;
+        vector<int> groups[NUM_POLICY_KINDS]; //By PolicyKind, available plans in ascending order
+};
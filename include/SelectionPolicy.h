@@ -1,36 +1,51 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <variant>
+#include "FacilityCatalog.h"
+#include "Log.h"
 using std::vector;
 using std::string;
 
-class FacilityType;
-
+/*
+Extension point for selection policies other than the built-in ones. A plan holds a custom
+policy through a CustomSelection and selects with it through this virtual interface.
+*/
 class SelectionPolicy {
     public:
         virtual ~SelectionPolicy() = default;
         virtual SelectionPolicy* clone() const = 0;
-        virtual const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) = 0;
+        virtual const FacilityType& selectFacility(const FacilityCatalog& facilitiesOptions) = 0;
         virtual const string toString() const = 0;
+        virtual int getCycleState() const;
 };
 
-class NaiveSelection : public SelectionPolicy {
+/*
+The built-in policies are small value types without virtual functions. A plan stores its policy
+inline (see PlanPolicy), so copying a plan for a backup does not allocate, and code that knows
+the policy type calls selectFacility directly, where it is inlined (Plan::stepWith).
+*/
+class NaiveSelection {
     public:
         NaiveSelection();
-        SelectionPolicy* clone() const override;
-        const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
-        const string toString() const override;
+        NaiveSelection(int lastSelectedIndex);
+        const FacilityType& selectFacility(const FacilityCatalog& facilitiesOptions);
+        const string toString() const;
+        int getCycleState() const;
 
     private:
         int lastSelectedIndex;
 };
 
-class BalancedSelection : public SelectionPolicy {
+class BalancedSelection {
     public:
         BalancedSelection(int LifeQualityScore, int EconomyScore, int EnvironmentScore);
-        SelectionPolicy* clone() const override;
-        const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
-        const string toString() const override;
+        const FacilityType& selectFacility(const FacilityCatalog& facilitiesOptions);
+        const string toString() const;
+        int getCycleState() const;
+        int getLifeQualityScore() const;
+        int getEconomyScore() const;
+        int getEnvironmentScore() const;
 
     private:
         int LifeQualityScore;
@@ -38,24 +53,129 @@ class BalancedSelection : public SelectionPolicy {
         int EnvironmentScore;
 };
 
-class EconomySelection : public SelectionPolicy {
+class EconomySelection {
     public:
         EconomySelection();
-        SelectionPolicy* clone() const override;
-        const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
-        const string toString() const override;
+        EconomySelection(int lastSelectedIndex);
+        const FacilityType& selectFacility(const FacilityCatalog& facilitiesOptions);
+        const string toString() const;
+        int getCycleState() const;
 
     private:
         int lastSelectedIndex;
+        int categoryCursor; //Position of the last selection in the catalog's category list
 };
 
-class SustainabilitySelection : public SelectionPolicy {
+class SustainabilitySelection {
     public:
         SustainabilitySelection();
-        SelectionPolicy* clone() const override;
-        const FacilityType& selectFacility(const vector<FacilityType>& facilitiesOptions) override;
-        const string toString() const override;
+        SustainabilitySelection(int lastSelectedIndex);
+        const FacilityType& selectFacility(const FacilityCatalog& facilitiesOptions);
+        const string toString() const;
+        int getCycleState() const;
 
     private:
         int lastSelectedIndex;
-};
\ No newline at end of file
+        int categoryCursor; //Position of the last selection in the catalog's category list
+};
+
+// Owns a custom policy, cloning it when copied
+class CustomSelection {
+    public:
+        explicit CustomSelection(SelectionPolicy *policy);
+        CustomSelection(const CustomSelection &other);
+        CustomSelection(CustomSelection &&other) noexcept;
+        CustomSelection &operator=(const CustomSelection &other);
+        CustomSelection &operator=(CustomSelection &&other) noexcept;
+        ~CustomSelection();
+        const FacilityType& selectFacility(const FacilityCatalog& facilitiesOptions);
+        const string toString() const;
+        int getCycleState() const;
+
+    private:
+        SelectionPolicy *policy;
+};
+
+// In the order of PlanPolicy's alternatives
+enum class PolicyKind {
+    NONE,
+    NAIVE,
+    BALANCED,
+    ECONOMY,
+    SUSTAINABILITY,
+    CUSTOM,
+};
+
+static const int NUM_POLICY_KINDS = 6;
+
+/*
+A plan's selection policy: one of the built-in policies, a custom one, or none (the plan was
+given a policy name that does not exist, and reports an error instead of building).
+*/
+class PlanPolicy {
+    public:
+        PlanPolicy();
+        PlanPolicy(const NaiveSelection &policy);
+        PlanPolicy(const BalancedSelection &policy);
+        PlanPolicy(const EconomySelection &policy);
+        PlanPolicy(const SustainabilitySelection &policy);
+        PlanPolicy(SelectionPolicy *policy); //Takes ownership
+        PolicyKind getKind() const;
+        bool isSet() const;
+        const FacilityType& selectFacility(const FacilityCatalog& facilitiesOptions);
+        const string toString() const;
+        int getCycleState() const;
+        template <typename Policy>
+        Policy &get() { //The caller knows the kind
+            return *std::get_if<Policy>(&policy);
+        }
+        template <typename Policy>
+        const Policy *getIf() const {
+            return std::get_if<Policy>(&policy);
+        }
+
+    private:
+        std::variant<std::monostate, NaiveSelection, BalancedSelection, EconomySelection, SustainabilitySelection, CustomSelection> policy;
+};
+
+[[noreturn]] void selectionFailed(const char *message); //Throws a std::runtime_error
+
+inline const FacilityType& NaiveSelection::selectFacility(const FacilityCatalog& facilitiesOptions) {
+    if (facilitiesOptions.empty()) {
+        selectionFailed("No facilities available for selection");
+    }
+    if (lastSelectedIndex >= facilitiesOptions.size()) {
+        selectionFailed("lastSelectedIndex out of bounds");
+    }
+    const FacilityType& selectedFacility = facilitiesOptions[lastSelectedIndex];
+    LOG_TRACE("NaiveSelection selected index " << lastSelectedIndex << ": " << selectedFacility.getName());
+    lastSelectedIndex = (lastSelectedIndex + 1) % facilitiesOptions.size();
+    return selectedFacility;
+}
+
+// The catalog scores all facility types in one vectorized pass (see FacilityCatalog::mostBalanced)
+inline const FacilityType& BalancedSelection::selectFacility(const FacilityCatalog& facilitiesOptions) {
+    int index = facilitiesOptions.mostBalanced(LifeQualityScore, EconomyScore, EnvironmentScore);
+    if (index == -1) {
+        selectionFailed("No facility found.");
+    }
+    return facilitiesOptions[index];
+}
+
+inline const FacilityType& EconomySelection::selectFacility(const FacilityCatalog& facilitiesOptions) {
+    int index = facilitiesOptions.nextInCategory(FacilityCategory::ECONOMY, lastSelectedIndex, categoryCursor);
+    if (index == -1) {
+        selectionFailed("No facility in the ECONOMY category found.");
+    }
+    lastSelectedIndex = (index + 1) % facilitiesOptions.size();
+    return facilitiesOptions[index];
+}
+
+inline const FacilityType& SustainabilitySelection::selectFacility(const FacilityCatalog& facilitiesOptions) {
+    int index = facilitiesOptions.nextInCategory(FacilityCategory::ENVIRONMENT, lastSelectedIndex, categoryCursor);
+    if (index == -1) {
+        selectionFailed("No facility in the ENVIRONMENT category found.");
+    }
+    lastSelectedIndex = (index + 1) % facilitiesOptions.size();
+    return facilitiesOptions[index];
+}
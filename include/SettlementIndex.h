@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+using std::string;
+using std::vector;
+
+class Settlement;
+
+/*
+Open-addressing (linear probing) hash index from settlement name to its handle, the position
+of the settlement in Simulation::settlements. Names are not copied: a slot stores the handle
+and the name's hash, and the name itself is read from the settlement when a probe hits.
+*/
+class SettlementIndex {
+    public:
+        SettlementIndex();
+        int find(std::string_view name, const vector<Settlement*> &settlements) const;
+        void insert(int handle, const vector<Settlement*> &settlements);
+        void erase(int handle, const vector<Settlement*> &settlements);
+        void rebuild(const vector<Settlement*> &settlements);
+
+    private:
+        struct Slot {
+            size_t hash;
+            int handle; //-1 for an empty slot
+        };
+        void grow();
+        vector<Slot> slots;
+        int count;
+};
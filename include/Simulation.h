@@ -1,44 +1,116 @@
 #pragma once
 #include <string>
 #include <vector>
+#include <memory>
+#include <ostream>
+#include <string_view>
 #include "Plan.h"
+#include "PlanStore.h"
 #include "Settlement.h"
 #include "SelectionPolicy.h"
 #include "Facility.h"
+#include "FacilityCatalog.h"
+#include "ConstructionScheduler.h"
+#include "SettlementIndex.h"
+#include "ActionJournal.h"
+#include "SelectionBatch.h"
+#include "ScoreTotals.h"
+#include "PlanRanking.h"
 using std::string;
 using std::vector;
 
 class BaseAction;
 class SelectionPolicy;
+class ThreadPool;
+class LineReader;
+class WriteAheadLog;
+class JournalReader;
+
+/*
+What createBackup keeps. The plans, the scheduler and the score totals are shared with the live simulation and
+only copied when the simulation next writes to them (plans chunk by chunk and plan by plan, see
+PlanStore), so taking a backup is O(1). Settlements, facility options and the actions log only
+ever grow, so their lengths are enough to roll them back.
+*/
+struct SimulationSnapshot {
+    std::shared_ptr<PlanStore> plans;
+    std::shared_ptr<ConstructionScheduler> scheduler;
+    std::shared_ptr<ScoreTotals> scoreTotals;
+    int planCounter;
+    int currentTick;
+    int numSettlements;
+    int numFacilities;
+    long long numActions;
+};
 
 class Simulation {
     public:
+        Simulation();
         Simulation(const string &configFilePath);
         ~Simulation();
         Simulation(const Simulation &other);
         Simulation &operator=(const Simulation &other);
         
         void start();
-        void addPlan(const Settlement &settlement, SelectionPolicy *selectionPolicy);
+        void start(LineReader &commands);
+        void addPlan(const Settlement &settlement, const PlanPolicy &selectionPolicy);
         void addAction(BaseAction *action);
         bool addSettlement(Settlement *settlement);
         bool addFacility(FacilityType facility);
         bool isSettlementExists(const string &settlementName);
         Settlement &getSettlement(const string &settlementName);
-        Plan &getPlan(const int planID);
+        const Plan &getPlan(const int planID) const;
+        Plan &getWritablePlan(const int planID);
+        int getSettlementHandle(const string &settlementName) const; //-1 if there is no such settlement
+        const ScoreTotals &getScoreTotals() const;
+        void getTopPlans(int k, RankMetric metric, vector<const Plan*> &topPlans);
         void step();
+        void step(int numSteps);
+        void setNumThreads(int numThreads);
         void close();
         void open();
-        vector<BaseAction*> getActionsLog();
+        const ActionJournal &getActionsLog() const;
+        void setLogCapacity(size_t maxRecords);
+        void setCompactHistory(bool compact);
+        void setWriteAheadLog(WriteAheadLog *writeAheadLog);
+        void setOutput(std::ostream &output);
+        std::ostream &getOutput();
+        int getCurrentTick() const;
+        long long replay(JournalReader &journal);
         void createBackup();
         void getRestore();
+        bool saveCheckpoint(const string &filePath);
+        bool loadCheckpoint(const string &filePath);
+        bool canSaveCheckpoint(const string &filePath) const; //False if the journal still replays from the file
 
     private:
         bool isRunning;
         int planCounter; //For assigning unique plan IDs
-        vector<BaseAction*> actionsLog;
-        vector<Plan> plans;
+        int currentTick; //Number of steps simulated so far
+        std::shared_ptr<ConstructionScheduler> scheduler; //Pending facility completions of all plans
+        ActionJournal actionsLog;
+        std::shared_ptr<PlanStore> plans; //Indexed by plan id, shared with the backup until written to
+        vector<int> planSettlements; //By plan id, the handle of the plan's settlement
+        std::shared_ptr<ScoreTotals> scoreTotals; //Shared with the backup until written to
+        PlanRanking planRanking; //Rebuilt instead of restored
         vector<Settlement*> settlements;
-        vector<FacilityType> facilitiesOptions;
-        static Simulation* backup;
+        SettlementIndex settlementIndex; //Name -> position in settlements
+        FacilityCatalog facilitiesOptions;
+        SimulationSnapshot *backup;
+        ThreadPool *threadPool; //Only set when stepping with more than one thread
+        WriteAheadLog *writeAheadLog; //Only set when commands are journaled, owned
+        bool compactHistory; //Plans keep per-type counts of operational facilities only
+        std::ostream *output; //What commands print goes here, std::cout unless setOutput was called
+        SelectionBatch selectionBatch;
+        vector<int> stepChoices, stepCompletionTicks, stepDuePlans; //Reused by every step()
+        template <typename Policy>
+        void stepGroup(PolicyKind kind);
+        PlanStore &writablePlans();
+        Plan &writablePlan(int index);
+        void checkPlanId(int planID) const;
+        ConstructionScheduler &writableScheduler();
+        ScoreTotals &writableScoreTotals();
+        void rebuildScoreTotals();
+        void copyPlans(const PlanStore &otherPlans);
+        bool runCommand(std::string_view command);
 };
\ No newline at end of file
@@ -0,0 +1,103 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+using std::string;
+
+/*
+Per-phase call counts, total time and latency histograms for the simulation's hot paths.
+Each thread records into its own block of counters, with no locking or shared cache lines; the
+blocks are only added up when the numbers are read, by the stats command or the Prometheus dump
+(bin/main --stats-file). Time is taken from the TSC where there is one, converted to seconds on
+read against steady_clock.
+
+Use the macros, which time the rest of the enclosing scope:
+
+    STATS_TIMER(Phase::SIMULATION_STEP);
+    STATS_SAMPLED_TIMER(Phase::PLAN_STEP);
+
+Reading the clock costs more than a per-plan phase does, so the sampled timer counts every call
+but only times the first calls and one in STATS_SAMPLE_PERIOD after that; the total time is
+scaled up from the timed calls. Defining STATS_ENABLED=0 compiles the timers out.
+*/
+
+enum class Phase {
+    SIMULATION_STEP, //Simulation::step, one tick of every plan
+    FAST_FORWARD, //Simulation::step(n) for long horizons
+    SELECT_BATCH, //SelectionBatch::select, once per tick
+    PLAN_STEP, //Plan::step of a plan that starts a facility
+    SELECT_FACILITY, //SelectionPolicy::selectFacility, for plans not served by the batch
+    FACILITY_STEP, //Plan::completeFacilities, facilities turning operational
+    CONFIG_LOAD,
+    BACKUP,
+    RESTORE,
+    CHECKPOINT_SAVE,
+    CHECKPOINT_LOAD,
+    COUNT
+};
+
+static const uint64_t STATS_SAMPLE_PERIOD = 64; //A power of two
+
+#ifndef STATS_ENABLED
+#define STATS_ENABLED 1
+#endif
+
+class Stats {
+    public:
+        static uint64_t now() { //Ticks of the timer clock
+#if defined(__x86_64__) || defined(__i386__)
+            return __rdtsc();
+#else
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+        }
+        static void record(Phase phase, uint64_t ticks);
+        static bool count(Phase phase); //Counts a call of a sampled phase, true if it is to be timed
+        static void recordSample(Phase phase, uint64_t ticks);
+        static double ticksPerSecond(); //Of the timer clock
+        static void print(std::ostream &out);
+        static bool writePrometheus(const string &filePath);
+        static void startDump(const string &filePath, int intervalSeconds); //Rewrites the file every interval
+        static void shutdown(); //Stops the dump, writing the file a last time
+};
+
+// Records the time from its construction to its destruction
+class PhaseTimer {
+    public:
+        PhaseTimer(Phase phase) : phase(phase), start(Stats::now()) {}
+        ~PhaseTimer() {
+            Stats::record(phase, Stats::now() - start);
+        }
+
+    private:
+        Phase phase;
+        uint64_t start;
+};
+
+// Counts every call, records the time of the ones Stats::count picks
+class SampledPhaseTimer {
+    public:
+        SampledPhaseTimer(Phase phase) : phase(phase), start(Stats::count(phase) ? Stats::now() : 0) {}
+        ~SampledPhaseTimer() {
+            if (start != 0) {
+                Stats::recordSample(phase, Stats::now() - start);
+            }
+        }
+
+    private:
+        Phase phase;
+        uint64_t start; //0 when the call is not timed
+};
+
+#if STATS_ENABLED
+#define STATS_TIMER(phase) PhaseTimer phaseTimer(phase)
+#define STATS_SAMPLED_TIMER(phase) SampledPhaseTimer phaseTimer(phase)
+#else
+#define STATS_TIMER(phase) do {} while (0)
+#define STATS_SAMPLED_TIMER(phase) do {} while (0)
+#endif
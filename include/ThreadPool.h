@@ -0,0 +1,48 @@
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+#include <utility>
+using std::vector;
+
+/*
+A fixed-size pool of worker threads used to split a loop over [0, count) into chunks.
+Every worker owns a queue of chunks; when its own queue runs dry it steals from the back of
+the other queues, so uneven chunks (e.g. METROPOLIS plans next to VILLAGE plans) even out.
+The calling thread takes part in the work as worker 0.
+*/
+class ThreadPool {
+    public:
+        ThreadPool(int numThreads);
+        ~ThreadPool();
+        ThreadPool(const ThreadPool &other) = delete;
+        ThreadPool &operator=(const ThreadPool &other) = delete;
+        int getNumThreads() const;
+        void parallelFor(int count, int chunkSize, const std::function<void(int, int)> &task);
+
+    private:
+        // chunks[head, size) are still queued; the vector keeps its capacity between jobs
+        struct ChunkQueue {
+            std::mutex mutex;
+            vector<std::pair<int, int>> chunks;
+            size_t head = 0;
+        };
+        void workerLoop(int workerId);
+        bool popChunk(int workerId, std::pair<int, int> &chunk);
+        bool runChunk(int workerId);
+
+        const int numThreads;
+        vector<std::thread> workers;
+        vector<ChunkQueue*> queues;
+        std::mutex mutex;
+        std::condition_variable wakeWorkers;
+        std::condition_variable jobDone;
+        const std::function<void(int, int)> *task;
+        std::exception_ptr failure;
+        int pendingChunks;
+        int generation;
+        bool stopping;
+};
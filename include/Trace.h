@@ -0,0 +1,54 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "Stats.h"
+using std::string;
+
+/*
+Opt-in timeline of a run (bin/main --trace <file>) in the Chrome trace-event format, which loads
+in Perfetto and chrome://tracing. Each traced scope becomes one complete event: its name, start,
+duration, thread, and a plan id or command text when it has one.
+
+Every thread appends to its own event buffer, with no locking; the buffers are only read when
+the file is written, by Trace::shutdown at exit. While tracing is off a scope costs one load and
+a branch.
+
+    TRACE_SCOPE("plan_step", plan_id);
+    TRACE_SCOPE_TEXT("command", command);
+*/
+
+class Trace {
+    public:
+        static void start(const string &filePath);
+        static bool isEnabled() {
+            return enabled.load(std::memory_order_relaxed);
+        }
+        static void record(const char *name, uint64_t start, uint64_t end, int id, std::string_view text);
+        static void shutdown(); //Writes the file if tracing was started
+
+    private:
+        static std::atomic<bool> enabled;
+};
+
+// Records the time from its construction to its destruction as one event
+class TraceScope {
+    public:
+        TraceScope(const char *name, int id, std::string_view text = std::string_view())
+            : name(name), id(id), text(text), start(Trace::isEnabled() ? Stats::now() : 0) {}
+        ~TraceScope() {
+            if (start != 0) {
+                Trace::record(name, start, Stats::now(), id, text);
+            }
+        }
+
+    private:
+        const char *name; //A literal, kept as is
+        int id;
+        std::string_view text; //Copied when the event is recorded
+        uint64_t start; //0 when tracing is off
+};
+
+#define TRACE_SCOPE(name, id) TraceScope traceScope(name, id)
+#define TRACE_SCOPE_TEXT(name, text) TraceScope traceScope(name, -1, text)
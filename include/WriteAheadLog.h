@@ -0,0 +1,112 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ActionJournal.h"
+#include "MappedFile.h"
+using std::string;
+
+/*
+Durable journal of the commands a simulation accepted, so a crashed session can be rebuilt with
+bin/main --replay <journal>.
+
+The file starts with a JournalHeader naming the base the commands apply to: the configuration
+file the session started from, or a checkpoint. The rest is a sequence of blocks, each a
+JournalBlockHeader (payload size and FNV-1a checksum) followed by entries:
+    JOURNAL_STRING   uint32 length, bytes       defines the next string id of the file
+    JOURNAL_ACTION   ActionRecord               a command to run again on replay
+    JOURNAL_HISTORY  ActionRecord               an actions log entry older than the base
+Records refer to strings by their id in the file. A block is written with one write() and
+synced once (group commit), so a crash can only leave a torn last block, which replay ignores.
+
+Saving a checkpoint with backup <file> compacts the journal: it is rewritten with the checkpoint
+as its base and the actions log as history, so replay time is bounded by the activity since
+the last checkpoint. While an in-memory backup exists the journal is not compacted, since the
+checkpoint cannot bring that backup back. Replay then still reads the old base and the checkpoints
+named by journaled restore <file> commands, so backup refuses to overwrite any of them
+(readsFile) for as long as compaction is held off.
+*/
+
+static const char JOURNAL_MAGIC[8] = {'S', 'P', 'L', 'J', 'R', 'N', 'L', '\0'};
+static const uint32_t JOURNAL_VERSION = 3; //2 added PRINT_AGGREGATE and 3 PRINT_TOP_PLANS, older journals still read
+
+enum JournalBase {
+    BASE_CONFIG,
+    BASE_CHECKPOINT,
+};
+
+enum JournalEntry : uint8_t {
+    JOURNAL_STRING,
+    JOURNAL_ACTION,
+    JOURNAL_HISTORY,
+};
+
+struct JournalHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t base; //JournalBase
+    uint32_t basePathLength; //The path follows the header
+    uint32_t reserved;
+};
+
+struct JournalBlockHeader {
+    uint32_t payloadSize;
+    uint32_t reserved;
+    uint64_t checksum;
+};
+
+class JournalReader;
+
+class WriteAheadLog {
+    public:
+        WriteAheadLog();
+        ~WriteAheadLog(); //Commits what is pending
+        WriteAheadLog(const WriteAheadLog &other) = delete;
+        WriteAheadLog &operator=(const WriteAheadLog &other) = delete;
+        bool create(const string &filePath, JournalBase base, const string &basePath);
+        bool reopen(const string &filePath, const JournalReader &journal);
+        void append(const ActionRecord &record, const ActionJournal &log);
+        void commit();
+        bool compact(const string &checkpointPath, const ActionJournal &log);
+        bool readsFile(const string &path) const; //True if replaying the journal reads the file at path
+
+    private:
+        void addEntry(JournalEntry kind, const ActionRecord &record, const ActionJournal &log);
+        int fileStringId(int logStringId, const ActionJournal &log);
+        bool writeBlock(int fd);
+        int fd;
+        string filePath;
+        string pending; //Entries not committed yet
+        std::unordered_map<string, int> stringIds; //String -> id in the file
+        std::vector<string> sourcePaths; //The base, then the checkpoint of every journaled restore <file>
+};
+
+/*
+Reads a journal back in place from a mapped file. Strings are collected into a dictionary as
+they are met, so makeAction on getStrings() turns the records into actions.
+*/
+class JournalReader {
+    public:
+        JournalReader();
+        bool open(const string &filePath); //False if the file is missing or not a journal
+        JournalBase getBase() const;
+        const string &getBasePath() const;
+        bool next(JournalEntry &kind, ActionRecord &record); //False after the last valid block
+        const ActionJournal &getStrings() const;
+        uint64_t getValidSize() const; //Bytes up to the end of the last valid block
+        bool isTorn() const; //True if reading stopped at a partial or corrupt block
+        const std::vector<string> &getSourcePaths() const; //The base and the restored checkpoints read so far
+
+    private:
+        bool nextBlock();
+        MappedFile file;
+        JournalBase base;
+        string basePath;
+        ActionJournal strings;
+        std::vector<string> sourcePaths;
+        uint64_t position;
+        uint64_t blockEnd;
+        uint64_t validSize;
+        bool torn;
+};
@@ -1,8 +1,24 @@
 #include "../include/Action.h"
 #include "../include/Simulation.h"
+#include "../include/Log.h"
+#include <initializer_list>
 #include <iostream>
 
+// Journal record of an action; unused arguments stay 0 so identical commands compare equal
+static ActionRecord makeRecord(ActionKind kind, ActionStatus status, std::initializer_list<int32_t> args) {
+    ActionRecord record = {kind, (uint8_t)status, 0, 1, {0, 0, 0, 0, 0, 0}};
+    int i = 0;
+    for (int32_t arg : args) {
+        record.args[i++] = arg;
+    }
+    return record;
+}
+
 void AddSettlement::act(Simulation &simulation) {
+    if (settlementType < SettlementType::VILLAGE || settlementType > SettlementType::METROPOLIS) {
+        error("Invalid settlement type");
+        return;
+    }
     if (simulation.isSettlementExists(settlementName)) {
         error("Settlement already exists");
         return;
@@ -18,6 +34,10 @@ AddSettlement *AddSettlement::clone() const {
     return new AddSettlement(*this);
 }
 
+ActionRecord AddSettlement::toRecord(ActionJournal &journal) const {
+    return makeRecord(ActionKind::ADD_SETTLEMENT, getStatus(), {journal.intern(settlementName), (int32_t)settlementType});
+}
+
 const string AddSettlement::toString() const {
     return "addSettlement " + settlementName + " " + std::to_string((int) settlementType);
 }
@@ -25,24 +45,27 @@ const string AddSettlement::toString() const {
 
 void AddPlan::act(Simulation &simulation) {
     if (!simulation.isSettlementExists(settlementName)) {
-        std::cerr << "Error: Settlement does not exist" << std::endl;
+        simulation.getOutput() << "Error: Settlement does not exist" << '\n';
+        error("Settlement does not exist");
         return;
     }
 
-    SelectionPolicy *policy = nullptr;
+    PlanPolicy policy;
     if (selectionPolicy == "nve") {
-        policy = new NaiveSelection();
+        policy = NaiveSelection();
     } else if (selectionPolicy == "eco") {
-        policy = new EconomySelection();
+        policy = EconomySelection();
     } else if (selectionPolicy == "bal") {
-        policy = new BalancedSelection(0, 0, 0);
+        policy = BalancedSelection(0, 0, 0);
     } else {
-        std::cerr << "Error: Unknown selection policy" << std::endl;
+        simulation.getOutput() << "Error: Unknown selection policy" << '\n';
+        error("Unknown selection policy");
         return;
     }
 
-    std::cout << "Adding plan with selection policy: " << selectionPolicy << " at address: " << policy << std::endl;
+    LOG_DEBUG("Adding plan for " << settlementName << " with selection policy " << selectionPolicy);
     simulation.addPlan(simulation.getSettlement(settlementName), policy);
+    complete();
 }
 
 AddPlan::AddPlan(const string &settlementName, const string &selectionPolicy) : settlementName(settlementName),
@@ -53,12 +76,20 @@ AddPlan *AddPlan::clone() const {
     return new AddPlan(*this);
 }
 
+ActionRecord AddPlan::toRecord(ActionJournal &journal) const {
+    return makeRecord(ActionKind::ADD_PLAN, getStatus(), {journal.intern(settlementName), journal.intern(selectionPolicy)});
+}
+
 const string AddPlan::toString() const {
     return "addPlan " + settlementName + " " + selectionPolicy;
 }
 
 void SimulateStep::act(Simulation &simulation) {
-    simulation.step();
+    if (numOfSteps > MAX_TICK - simulation.getCurrentTick()) {
+        error("Simulation cannot run past tick " + std::to_string(MAX_TICK));
+        return;
+    }
+    simulation.step(numOfSteps);
     complete();
 }
 
@@ -68,18 +99,22 @@ SimulateStep *SimulateStep::clone() const {
     return new SimulateStep(*this);
 }
 
+ActionRecord SimulateStep::toRecord(ActionJournal &) const {
+    return makeRecord(ActionKind::SIMULATE_STEP, getStatus(), {numOfSteps});
+}
+
 const string SimulateStep::toString() const {
     return "simulateStep " + std::to_string(numOfSteps);
 }
 
 void PrintPlanStatus::act(Simulation &simulation) {
     try {
-        Plan &plan = simulation.getPlan(planId);
-        std::cout << "Plan ID: " << plan.getPlanId() << std::endl
-                  << "Settlement name: " << plan.getSettlement().getName() << std::endl
-                  << "Life quality score: " << plan.getlifeQualityScore() << std::endl
-                  << "Economy score: " << plan.getEconomyScore() << std::endl
-                  << "Environment score: " << plan.getEnvironmentScore() << std::endl;
+        const Plan &plan = simulation.getPlan(planId);
+        simulation.getOutput() << "Plan ID: " << plan.getPlanId() << '\n'
+                  << "Settlement name: " << plan.getSettlement().getName() << '\n'
+                  << "Life quality score: " << plan.getlifeQualityScore() << '\n'
+                  << "Economy score: " << plan.getEconomyScore() << '\n'
+                  << "Environment score: " << plan.getEnvironmentScore() << '\n';
         complete();
     } catch (...) {
         error("Plan does not exist");
@@ -93,11 +128,106 @@ PrintPlanStatus *PrintPlanStatus::clone() const {
     return new PrintPlanStatus(*this);
 }
 
+ActionRecord PrintPlanStatus::toRecord(ActionJournal &) const {
+    return makeRecord(ActionKind::PRINT_PLAN_STATUS, getStatus(), {planId});
+}
+
 const string PrintPlanStatus::toString() const {
     return "printPlanStatus " + std::to_string(planId);
 }
 
 
+// Answered from the simulation's running totals, without looking at the plans
+void PrintAggregate::act(Simulation &simulation) {
+    const ScoreTotals &totals = simulation.getScoreTotals();
+    ScoreTotal total;
+    if (!settlementName.empty()) {
+        int handle = simulation.getSettlementHandle(settlementName);
+        if (handle == -1) {
+            error("Settlement does not exist");
+            return;
+        }
+        total = totals.getBySettlement(handle);
+        simulation.getOutput() << "Settlement name: " << settlementName << '\n';
+    } else if (byType) {
+        if (settlementType < (int)SettlementType::VILLAGE || settlementType > (int)SettlementType::METROPOLIS) {
+            error("Unknown settlement type");
+            return;
+        }
+        total = totals.getByType((SettlementType)settlementType);
+        simulation.getOutput() << "Settlement type: " << settlementType << '\n';
+    } else {
+        total = totals.getGlobal();
+        simulation.getOutput() << "All settlements" << '\n';
+    }
+    simulation.getOutput() << "Plans: " << total.numPlans << '\n'
+              << "Life quality score: " << total.lifeQualityScore << '\n'
+              << "Economy score: " << total.economyScore << '\n'
+              << "Environment score: " << total.environmentScore << '\n';
+    complete();
+}
+
+PrintAggregate::PrintAggregate() : byType(false), settlementType(-1) {}
+
+PrintAggregate::PrintAggregate(const string &settlementName) : settlementName(settlementName), byType(false), settlementType(-1) {}
+
+PrintAggregate::PrintAggregate(SettlementType settlementType) : byType(true), settlementType((int)settlementType) {}
+
+PrintAggregate *PrintAggregate::clone() const {
+    return new PrintAggregate(*this);
+}
+
+ActionRecord PrintAggregate::toRecord(ActionJournal &journal) const {
+    return makeRecord(ActionKind::PRINT_AGGREGATE, getStatus(), {settlementName.empty() ? -1 : journal.intern(settlementName), settlementType, byType});
+}
+
+const string PrintAggregate::toString() const {
+    if (!settlementName.empty()) {
+        return "printAggregate settlement " + settlementName;
+    }
+    if (byType) {
+        return "printAggregate type " + std::to_string(settlementType);
+    }
+    return "printAggregate";
+}
+
+
+void PrintTopPlans::act(Simulation &simulation) {
+    static const char *const LABELS[NUM_RANK_METRICS] = {"Life quality score", "Economy score", "Environment score", "Balance spread"};
+    RankMetric rankMetric;
+    if (!PlanRanking::parseMetric(metric, rankMetric)) {
+        error("Unknown metric, expected life, economy, environment or spread");
+        return;
+    }
+    if (k <= 0) {
+        error("k must be positive");
+        return;
+    }
+    vector<const Plan*> topPlans;
+    simulation.getTopPlans(k, rankMetric, topPlans);
+    for (size_t i = 0; i < topPlans.size(); i++) {
+        const Plan &plan = *topPlans[i];
+        simulation.getOutput() << i + 1 << ". Plan ID: " << plan.getPlanId() << ", Settlement name: " << plan.getSettlement().getName()
+                  << ", " << LABELS[(int)rankMetric] << ": " << PlanRanking::value(plan, rankMetric) << '\n';
+    }
+    complete();
+}
+
+PrintTopPlans::PrintTopPlans(int k, const string &metric) : k(k), metric(metric) {}
+
+PrintTopPlans *PrintTopPlans::clone() const {
+    return new PrintTopPlans(*this);
+}
+
+ActionRecord PrintTopPlans::toRecord(ActionJournal &journal) const {
+    return makeRecord(ActionKind::PRINT_TOP_PLANS, getStatus(), {k, journal.intern(metric)});
+}
+
+const string PrintTopPlans::toString() const {
+    return "printTopPlans " + std::to_string(k) + " " + metric;
+}
+
+
 void AddFacility::act(Simulation &simulation) {
     if (price < 0 || lifeQualityScore < 0 || economyScore < 0 || environmentScore < 0) {
         error("Invalid facility parameters");
@@ -123,6 +253,10 @@ AddFacility *AddFacility::clone() const {
     return new AddFacility(*this);
 }
 
+ActionRecord AddFacility::toRecord(ActionJournal &journal) const {
+    return makeRecord(ActionKind::ADD_FACILITY, getStatus(), {journal.intern(facilityName), (int32_t)facilityCategory, price, lifeQualityScore, economyScore, environmentScore});
+}
+
 
 
 const string AddFacility::toString() const {
@@ -134,16 +268,16 @@ const string AddFacility::toString() const {
 
 void ChangePlanPolicy::act(Simulation &simulation) {
     try {
-        Plan &plan = simulation.getPlan(planId);
-        SelectionPolicy *selectionPolicy = nullptr;
+        Plan &plan = simulation.getWritablePlan(planId);
+        PlanPolicy selectionPolicy;
         if (newPolicy == "nve") {
-            selectionPolicy = new NaiveSelection();
+            selectionPolicy = NaiveSelection();
         } else if (newPolicy == "eco") {
-            selectionPolicy = new EconomySelection();
+            selectionPolicy = EconomySelection();
         } else if (newPolicy == "env") {
-            selectionPolicy = new SustainabilitySelection();
+            selectionPolicy = SustainabilitySelection();
         } else if (newPolicy == "bal") {
-            selectionPolicy = new BalancedSelection(0, 0, 0);
+            selectionPolicy = BalancedSelection(0, 0, 0);
         } else {
             error("Unknown selection policy");
             return;
@@ -162,31 +296,36 @@ ChangePlanPolicy *ChangePlanPolicy::clone() const {
     return new ChangePlanPolicy(*this);
 }
 
+ActionRecord ChangePlanPolicy::toRecord(ActionJournal &journal) const {
+    return makeRecord(ActionKind::CHANGE_PLAN_POLICY, getStatus(), {planId, journal.intern(newPolicy)});
+}
+
 const string ChangePlanPolicy::toString() const {
     return "changePlanPolicy " + std::to_string(planId) + " " + newPolicy;
 }
 
 void PrintActionsLog::act(Simulation &simulation) {
     
-    string actionStatus;
-    for (auto action : simulation.getActionsLog()) {
-        if((int)action->getStatus() == 0) {
-            actionStatus = "COMPLETED";
-        } else {
-            actionStatus = "ERROR";
-        }
-        std::cout << action->toString() << " " << actionStatus << std::endl;
-    }
+    simulation.getActionsLog().print(first, count, simulation.getOutput());
     complete();
 }
 
-PrintActionsLog::PrintActionsLog() {}
+PrintActionsLog::PrintActionsLog() : first(0), count(-1) {}
+
+PrintActionsLog::PrintActionsLog(int first, int count) : first(first), count(count) {}
 
 PrintActionsLog *PrintActionsLog::clone() const {
     return new PrintActionsLog(*this);
 }
 
+ActionRecord PrintActionsLog::toRecord(ActionJournal &) const {
+    return makeRecord(ActionKind::PRINT_ACTIONS_LOG, getStatus(), {first, count});
+}
+
 const string PrintActionsLog::toString() const {
+    if (count != -1) {
+        return "printActionsLog " + std::to_string(first) + " " + std::to_string(count);
+    }
     return "printActionsLog";
 }
 
@@ -202,53 +341,79 @@ Close *Close::clone() const {
     return new Close(*this);
 }
 
+ActionRecord Close::toRecord(ActionJournal &) const {
+    return makeRecord(ActionKind::CLOSE, getStatus(), {});
+}
+
 const string Close::toString() const {
     return "close";
 }
 
 void BackupSimulation::act(Simulation &simulation) {
-    simulation.createBackup();
+    if (filePath.empty()) {
+        simulation.createBackup();
+    } else if (!simulation.canSaveCheckpoint(filePath)) {
+        error("Cannot overwrite checkpoint " + filePath + ", the journal replays from it");
+        return;
+    } else if (!simulation.saveCheckpoint(filePath)) {
+        error("Cannot write checkpoint " + filePath);
+        return;
+    }
     complete();
 }
 
 
 BackupSimulation::BackupSimulation() {}
 
+BackupSimulation::BackupSimulation(const string &filePath): filePath(filePath) {}
+
 BackupSimulation *BackupSimulation::clone() const {
     return new BackupSimulation(*this);
 }
 
+ActionRecord BackupSimulation::toRecord(ActionJournal &journal) const {
+    return makeRecord(ActionKind::BACKUP, getStatus(), {filePath.empty() ? -1 : journal.intern(filePath)});
+}
+
 
 const string BackupSimulation::toString() const {
+    if (!filePath.empty()) {
+        return "backup " + filePath;
+    }
     return "backup";
 }
 
 void RestoreSimulation::act(Simulation &simulation) {
-    simulation.getRestore();
+    if (filePath.empty()) {
+        simulation.getRestore();
+    } else if (!simulation.loadCheckpoint(filePath)) {
+        error("Cannot restore checkpoint " + filePath);
+        return;
+    }
     complete();
 }
 
 RestoreSimulation::RestoreSimulation() {}
 
+RestoreSimulation::RestoreSimulation(const string &filePath): filePath(filePath) {}
+
 RestoreSimulation *RestoreSimulation::clone() const {
     return new RestoreSimulation(*this);
 }
 
-const string RestoreSimulation::toString() const {
-    return "restore";
-}
-
-void error(const string &message) {
-    std::cerr << "Error: " << message << std::endl;
+ActionRecord RestoreSimulation::toRecord(ActionJournal &journal) const {
+    return makeRecord(ActionKind::RESTORE, getStatus(), {filePath.empty() ? -1 : journal.intern(filePath)});
 }
 
-
-void complete() {
-    std::cout << "Action completed" << std::endl;
+const string RestoreSimulation::toString() const {
+    if (!filePath.empty()) {
+        return "restore " + filePath;
+    }
+    return "restore";
 }
 
 void BaseAction::act(Simulation &simulation) {
-    std::cout << "Base action" << std::endl;
+    simulation.getOutput() << "Base action" << '\n';
 }
 
 
@@ -0,0 +1,182 @@
+#include "../include/ActionJournal.h"
+#include "../include/Action.h"
+#include "../include/Settlement.h"
+#include "../include/Facility.h"
+#include <cstring>
+#include <ostream>
+
+ActionJournal::ActionJournal() : head(0), numRecords(0), capacity(0), numCommands(0), numLogged(0) {}
+
+void ActionJournal::setCapacity(size_t maxRecords) {
+    vector<ActionRecord> kept;
+    size_t first = maxRecords != 0 && numRecords > maxRecords ? numRecords - maxRecords : 0;
+    for (size_t i = 0; i < first; i++) {
+        numCommands -= getRecord(i).repeat;
+    }
+    for (size_t i = first; i < numRecords; i++) {
+        kept.push_back(getRecord(i));
+    }
+    records.swap(kept);
+    head = 0;
+    numRecords = records.size();
+    capacity = maxRecords;
+}
+
+void ActionJournal::append(const ActionRecord &record) {
+    numLogged += record.repeat;
+    numCommands += record.repeat;
+    if (numRecords > 0) {
+        ActionRecord &last = records[(head + numRecords - 1) % records.size()];
+        if (last.kind == record.kind && last.status == record.status && std::memcmp(last.args, record.args, sizeof(record.args)) == 0) {
+            last.repeat += record.repeat;
+            return;
+        }
+    }
+    if (numRecords < records.size()) {
+        records[(head + numRecords) % records.size()] = record;
+        numRecords++;
+    } else if (capacity == 0 || records.size() < capacity) {
+        records.push_back(record); //head is 0 until the ring is full
+        numRecords++;
+    } else {
+        numCommands -= records[head].repeat;
+        records[head] = record;
+        head = (head + 1) % records.size();
+    }
+}
+
+int ActionJournal::intern(std::string_view text) {
+    auto found = stringIds.find(string(text));
+    if (found != stringIds.end()) {
+        return found->second;
+    }
+    strings.emplace_back(text);
+    stringIds.emplace(strings.back(), strings.size() - 1);
+    return strings.size() - 1;
+}
+
+const string &ActionJournal::getString(int id) const {
+    return strings[id];
+}
+
+int ActionJournal::getNumStrings() const {
+    return strings.size();
+}
+
+long long ActionJournal::size() const {
+    return numCommands;
+}
+
+long long ActionJournal::getNumLogged() const {
+    return numLogged;
+}
+
+// Drops the newest commands until numLogged commands are left (counting dropped old ones)
+void ActionJournal::truncate(long long numLogged) {
+    while (this->numLogged > numLogged && numRecords > 0) {
+        ActionRecord &last = records[(head + numRecords - 1) % records.size()];
+        long long excess = this->numLogged - numLogged;
+        if (last.repeat > excess) {
+            last.repeat -= excess;
+            this->numLogged -= excess;
+            numCommands -= excess;
+        } else {
+            this->numLogged -= last.repeat;
+            numCommands -= last.repeat;
+            numRecords--;
+        }
+    }
+    if (numRecords == 0) {
+        this->numLogged = numLogged < this->numLogged ? numLogged : this->numLogged;
+        head = 0;
+        records.clear();
+    }
+}
+
+// Prints count commands (all when negative) starting at first; a negative first counts from the end
+void ActionJournal::print(long long first, long long count, std::ostream &out) const {
+    if (first < 0) {
+        first = numCommands + first > 0 ? numCommands + first : 0;
+    }
+    long long last = count < 0 || first + count > numCommands ? numCommands : first + count;
+    // Find the record holding command first, walking in from the closer end so printing the
+    // tail of a long log does not scan all of it
+    size_t i = 0;
+    long long position = 0; //Index of the first command of record i
+    if (first > numCommands / 2) {
+        i = numRecords;
+        position = numCommands;
+        while (i > 0 && position > first) {
+            i--;
+            position -= getRecord(i).repeat;
+        }
+    } else {
+        while (i < numRecords && position + getRecord(i).repeat <= first) {
+            position += getRecord(i).repeat;
+            i++;
+        }
+    }
+    for (; i < numRecords && position < last; i++) {
+        const ActionRecord &record = getRecord(i);
+        long long begin = position > first ? position : first;
+        long long end = position + record.repeat < last ? position + record.repeat : last;
+        if (begin < end) {
+            string line = describe(record) + (record.status == (uint8_t)ActionStatus::COMPLETED ? " COMPLETED" : " ERROR");
+            for (long long k = begin; k < end; k++) {
+                out << line << '\n';
+            }
+        }
+        position += record.repeat;
+    }
+}
+
+// Rebuilds the action a record was made from (caller deletes it)
+BaseAction *ActionJournal::makeAction(const ActionRecord &record) const {
+    const int32_t *args = record.args;
+    switch (record.kind) {
+        case ActionKind::ADD_SETTLEMENT:
+            return new AddSettlement(getString(args[0]), (SettlementType)args[1]);
+        case ActionKind::ADD_FACILITY:
+            return new AddFacility(getString(args[0]), (FacilityCategory)args[1], args[2], args[3], args[4], args[5]);
+        case ActionKind::ADD_PLAN:
+            return new AddPlan(getString(args[0]), getString(args[1]));
+        case ActionKind::SIMULATE_STEP:
+            return new SimulateStep(args[0]);
+        case ActionKind::PRINT_PLAN_STATUS:
+            return new PrintPlanStatus(args[0]);
+        case ActionKind::CHANGE_PLAN_POLICY:
+            return new ChangePlanPolicy(args[0], getString(args[1]));
+        case ActionKind::PRINT_ACTIONS_LOG:
+            return new PrintActionsLog(args[0], args[1]);
+        case ActionKind::CLOSE:
+            return new Close();
+        case ActionKind::BACKUP:
+            return args[0] == -1 ? new BackupSimulation() : new BackupSimulation(getString(args[0]));
+        case ActionKind::RESTORE:
+            return args[0] == -1 ? new RestoreSimulation() : new RestoreSimulation(getString(args[0]));
+        case ActionKind::PRINT_AGGREGATE:
+            if (args[0] != -1) {
+                return new PrintAggregate(getString(args[0]));
+            }
+            return args[2] != 0 ? new PrintAggregate((SettlementType)args[1]) : new PrintAggregate(); //args[2]: by type
+        case ActionKind::PRINT_TOP_PLANS:
+            return new PrintTopPlans(args[0], getString(args[1]));
+    }
+    return nullptr;
+}
+
+// The action's own toString, so the log reads exactly as before
+string ActionJournal::describe(const ActionRecord &record) const {
+    BaseAction *action = makeAction(record);
+    string text = action->toString();
+    delete action;
+    return text;
+}
+
+size_t ActionJournal::getNumRecords() const {
+    return numRecords;
+}
+
+const ActionRecord &ActionJournal::getRecord(size_t index) const {
+    return records[(head + index) % records.size()];
+}
@@ -1,4 +1,9 @@
 #include "../include/Auxiliary.h"
+#include <charconv>
+#include <cstring>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
 /*
 This is a 'static' method that receives a string(line) and returns a vector of the string's arguments.
 
@@ -18,3 +23,159 @@ std::vector<std::string> Auxiliary::parseArguments(const std::string& line) {
 
     return arguments;
 }
+
+// The characters operator>> stops at in the "C" locale: ' ', \t, \n, \v, \f, \r
+static bool isSpace(char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/*
+Allocation-free version of parseArguments: splits the line on whitespace into views of the line
+itself, storing at most maxArguments of them. Returns the total number of arguments, which is
+larger than maxArguments when some did not fit.
+The views are only valid while the line's buffer is.
+*/
+int Auxiliary::tokenize(std::string_view line, std::string_view *arguments, int maxArguments) {
+    int count = 0;
+    size_t i = 0;
+    while (i < line.size()) {
+        while (i < line.size() && isSpace(line[i])) {
+            i++;
+        }
+        if (i == line.size()) {
+            break;
+        }
+        size_t begin = i;
+        while (i < line.size() && !isSpace(line[i])) {
+            i++;
+        }
+        if (count < maxArguments) {
+            arguments[count] = line.substr(begin, i - begin);
+        }
+        count++;
+    }
+    return count;
+}
+
+// Parses the whole text as a decimal int; false (and value untouched) if it is not one
+bool Auxiliary::parseInt(std::string_view text, int &value) {
+    const char *end = text.data() + text.size();
+    if (!text.empty() && text[0] == '+') { //Accepted by std::stoi, not by from_chars
+        text.remove_prefix(1);
+        if (!text.empty() && text[0] == '-') { //"+-5" is not a number to std::stoi either
+            return false;
+        }
+    }
+    int parsed;
+    std::from_chars_result result = std::from_chars(text.data(), end, parsed);
+    if (text.empty() || result.ec != std::errc() || result.ptr != end) {
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+/*
+Output buffer used in batch mode. std::cout is pointed at it, so everything the simulation prints
+collects in one large buffer that is written to stdout with a single write when full, and
+otherwise only when std::cout is flushed (the flush command) or batch mode ends.
+*/
+class BatchOutputBuffer : public std::streambuf {
+    public:
+        BatchOutputBuffer() : buffer(1 << 20) {
+            setp(buffer.data(), buffer.data() + buffer.size());
+        }
+        bool writeOut() {
+            if (!Auxiliary::writeAll(STDOUT_FILENO, pbase(), pptr() - pbase())) {
+                return false;
+            }
+            setp(buffer.data(), buffer.data() + buffer.size());
+            return true;
+        }
+
+    protected:
+        int_type overflow(int_type c) override {
+            if (!writeOut()) {
+                return traits_type::eof();
+            }
+            if (!traits_type::eq_int_type(c, traits_type::eof())) {
+                *pptr() = traits_type::to_char_type(c);
+                pbump(1);
+            }
+            return traits_type::not_eof(c);
+        }
+        std::streamsize xsputn(const char *data, std::streamsize size) override {
+            if (size > epptr() - pptr() && !writeOut()) {
+                return 0;
+            }
+            if (size > epptr() - pptr()) { //Larger than the whole buffer
+                return Auxiliary::writeAll(STDOUT_FILENO, data, size) ? size : 0;
+            }
+            std::memcpy(pptr(), data, size);
+            pbump(size);
+            return size;
+        }
+        int sync() override {
+            return writeOut() ? 0 : -1;
+        }
+
+    private:
+        std::vector<char> buffer;
+};
+
+static BatchOutputBuffer *batchOutput = nullptr;
+static std::streambuf *consoleOutput = nullptr;
+
+// Batch mode: unsynced iostreams, std::cout collected in BatchOutputBuffer. Disabling flushes it.
+void Auxiliary::setBatchOutput(bool enabled) {
+    if (enabled && batchOutput == nullptr) {
+        std::cout.flush();
+        std::ios::sync_with_stdio(false);
+        std::cin.tie(nullptr);
+        batchOutput = new BatchOutputBuffer();
+        consoleOutput = std::cout.rdbuf(batchOutput);
+    } else if (!enabled && batchOutput != nullptr) {
+        std::cout.flush();
+        std::cout.rdbuf(consoleOutput);
+        delete batchOutput;
+        batchOutput = nullptr;
+    }
+}
+
+bool Auxiliary::writeAll(int fd, const void *data, size_t size) {
+    const char *bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t written = ::write(fd, bytes, size);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        bytes += written;
+        size -= written;
+    }
+    return true;
+}
+
+bool Auxiliary::syncParentDirectory(const std::string &path) {
+    size_t slash = path.rfind('/');
+    std::string directory = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    int fd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (fd == -1) {
+        return false;
+    }
+    bool synced = ::fsync(fd) == 0;
+    ::close(fd);
+    return synced;
+}
+
+// 64-bit FNV-1a, used to checksum checkpoints and journal blocks
+uint64_t Auxiliary::fnv1a(const void *data, size_t size, uint64_t hash) {
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,411 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <atomic>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../include/Checkpoint.h"
+#include "../include/MappedFile.h"
+#include "../include/Simulation.h"
+#include "../include/Action.h"
+#include "../include/Auxiliary.h"
+#include "../include/Stats.h"
+using std::string;
+using std::vector;
+
+// Binary checkpoints of a Simulation; the file layout is described in include/Checkpoint.h
+
+static uint64_t alignUp(uint64_t offset) {
+    return (offset + 7) & ~(uint64_t)7;
+}
+
+static const uint64_t RECORD_SIZE[NUM_SECTIONS] = {1, sizeof(SettlementRecord), sizeof(FacilityTypeRecord), sizeof(PlanRecord), sizeof(FacilityCountRecord), sizeof(PendingRecord), sizeof(SkippedRecord)};
+
+static const size_t WRITE_BUFFER_SIZE = 1 << 20;
+
+// Writes the payload sequentially through a buffer, hashing it on the way so it never has to be held in memory
+struct CheckpointWriter {
+    int fd;
+    uint64_t checksum;
+    uint64_t offset;
+    vector<char> buffer;
+    bool failed = false;
+
+    void write(const void *data, size_t size) {
+        const char *bytes = static_cast<const char*>(data);
+        buffer.insert(buffer.end(), bytes, bytes + size);
+        if (buffer.size() >= WRITE_BUFFER_SIZE) {
+            flush();
+        }
+        checksum = Auxiliary::fnv1a(data, size, checksum);
+        offset += size;
+    }
+    bool flush() {
+        failed = failed || !Auxiliary::writeAll(fd, buffer.data(), buffer.size());
+        buffer.clear();
+        return !failed;
+    }
+    void padTo(uint64_t target) {
+        static const char zeros[8] = {0};
+        write(zeros, target - offset);
+    }
+};
+
+static int policyKind(const PlanPolicy &policy, int32_t *state) {
+    if (const BalancedSelection *balanced = policy.getIf<BalancedSelection>()) {
+        state[0] = balanced->getLifeQualityScore();
+        state[1] = balanced->getEconomyScore();
+        state[2] = balanced->getEnvironmentScore();
+        return POLICY_BALANCED;
+    }
+    state[0] = policy.getCycleState();
+    switch (policy.getKind()) {
+        case PolicyKind::NAIVE:
+            return POLICY_NAIVE;
+        case PolicyKind::ECONOMY:
+            return POLICY_ECONOMY;
+        case PolicyKind::SUSTAINABILITY:
+            return POLICY_SUSTAINABILITY;
+        default:
+            return -1;
+    }
+}
+
+static PlanPolicy makePolicy(int kind, const int32_t *state) {
+    switch (kind) {
+        case POLICY_NAIVE:
+            return NaiveSelection(state[0]);
+        case POLICY_BALANCED:
+            return BalancedSelection(state[0], state[1], state[2]);
+        case POLICY_ECONOMY:
+            return EconomySelection(state[0]);
+        case POLICY_SUSTAINABILITY:
+            return SustainabilitySelection(state[0]);
+        default:
+            return PlanPolicy();
+    }
+}
+
+// Written next to its path, synced and renamed over it, so a crash mid-save leaves the old checkpoint
+// whole and a simulation that has the old one mapped never sees it change under it
+static string checkpointTempPath(const string &filePath) {
+    static std::atomic<int> numWritten(0);
+    return filePath + ".tmp." + std::to_string(::getpid()) + "." + std::to_string(numWritten++);
+}
+
+bool Simulation::saveCheckpoint(const string &filePath){
+    STATS_TIMER(Phase::CHECKPOINT_SAVE);
+    CheckpointHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic));
+    header.version = CHECKPOINT_VERSION;
+    header.headerSize = sizeof(CheckpointHeader);
+    header.planCounter = planCounter;
+    header.currentTick = currentTick;
+
+    // Sizes first, so every section offset is known before anything is written
+    uint64_t stringsSize = 0;
+    for (Settlement *settlement : settlements){
+        stringsSize += settlement->getName().size();
+    }
+    for (const FacilityType &type : facilitiesOptions){
+        stringsSize += type.getName().size();
+    }
+    uint64_t numOperational = 0, numPending = 0, numSkipped = 0;
+    for (int i = 0; i < plans->size(); i++){
+        const Plan &plan = (*plans)[i];
+        if (!plan.getSelectionPolicy().isSet()){
+            *output << "Error: plan " << plan.getPlanId() << " has no selection policy" << '\n';
+            return false;
+        }
+        numOperational += plan.getOperationalRuns().size();
+        numPending += plan.getUnderConstruction().size();
+        for (long long count : plan.getSkippedOperational()){
+            numSkipped += count != 0;
+        }
+    }
+    header.sectionCount[SECTION_STRINGS] = stringsSize;
+    header.sectionCount[SECTION_SETTLEMENTS] = settlements.size();
+    header.sectionCount[SECTION_FACILITY_TYPES] = facilitiesOptions.size();
+    header.sectionCount[SECTION_PLANS] = plans->size();
+    header.sectionCount[SECTION_OPERATIONAL] = numOperational;
+    header.sectionCount[SECTION_PENDING] = numPending;
+    header.sectionCount[SECTION_SKIPPED] = numSkipped;
+    uint64_t offset = alignUp(sizeof(CheckpointHeader));
+    for (int section = 0; section < NUM_SECTIONS; section++){
+        header.sectionOffset[section] = offset;
+        offset = alignUp(offset + header.sectionCount[section] * RECORD_SIZE[section]);
+    }
+    header.fileSize = offset;
+
+    string tempPath = checkpointTempPath(filePath);
+    int fd = ::open(tempPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1){
+        *output << "Error: cannot write checkpoint " << filePath << '\n';
+        return false;
+    }
+    CheckpointWriter writer{fd, Auxiliary::fnv1a(nullptr, 0), sizeof(header), {}};
+    writer.buffer.assign(reinterpret_cast<const char*>(&header), reinterpret_cast<const char*>(&header) + sizeof(header)); //Rewritten with the checksum at the end
+
+    writer.padTo(header.sectionOffset[SECTION_STRINGS]);
+    for (Settlement *settlement : settlements){
+        writer.write(settlement->getName().data(), settlement->getName().size());
+    }
+    for (const FacilityType &type : facilitiesOptions){
+        writer.write(type.getName().data(), type.getName().size());
+    }
+
+    uint32_t nameOffset = 0;
+    writer.padTo(header.sectionOffset[SECTION_SETTLEMENTS]);
+    for (Settlement *settlement : settlements){
+        SettlementRecord record = {nameOffset, (uint32_t)settlement->getName().size(), (int32_t)settlement->getType(), 0};
+        writer.write(&record, sizeof(record));
+        nameOffset += record.nameLength;
+    }
+    writer.padTo(header.sectionOffset[SECTION_FACILITY_TYPES]);
+    for (const FacilityType &type : facilitiesOptions){
+        FacilityTypeRecord record = {nameOffset, (uint32_t)type.getName().size(), (int32_t)type.getCategory(), type.getCost(), type.getLifeQualityScore(), type.getEconomyScore(), type.getEnvironmentScore(), 0};
+        writer.write(&record, sizeof(record));
+        nameOffset += record.nameLength;
+    }
+
+    uint32_t firstOperational = 0, firstPending = 0, firstSkipped = 0;
+    writer.padTo(header.sectionOffset[SECTION_PLANS]);
+    for (int i = 0; i < plans->size(); i++){
+        const Plan &plan = (*plans)[i];
+        PlanRecord record;
+        std::memset(&record, 0, sizeof(record));
+        record.planId = plan.getPlanId();
+        record.settlement = planSettlements[i];
+        record.policy = policyKind(plan.getSelectionPolicy(), record.policyState);
+        if (record.policy == -1){
+            *output << "Error: plan " << record.planId << " uses a selection policy checkpoints do not support" << '\n';
+            ::close(fd);
+            std::remove(tempPath.c_str());
+            return false;
+        }
+        record.status = (int32_t)plan.getLastStatus();
+        record.lifeQualityScore = plan.getlifeQualityScore();
+        record.economyScore = plan.getEconomyScore();
+        record.environmentScore = plan.getEnvironmentScore();
+        record.firstOperational = firstOperational;
+        record.numOperational = plan.getOperationalRuns().size();
+        record.firstPending = firstPending;
+        record.numPending = plan.getUnderConstruction().size();
+        record.firstSkipped = firstSkipped;
+        for (long long count : plan.getSkippedOperational()){
+            record.numSkipped += count != 0;
+        }
+        firstOperational += record.numOperational;
+        firstPending += record.numPending;
+        firstSkipped += record.numSkipped;
+        writer.write(&record, sizeof(record));
+    }
+    writer.padTo(header.sectionOffset[SECTION_OPERATIONAL]);
+    for (int i = 0; i < plans->size(); i++){
+        const Plan &plan = (*plans)[i];
+        for (const FacilityRun &run : plan.getOperationalRuns()){
+            FacilityCountRecord record = {run.typeId, run.count};
+            writer.write(&record, sizeof(record));
+        }
+    }
+    writer.padTo(header.sectionOffset[SECTION_PENDING]);
+    for (int i = 0; i < plans->size(); i++){
+        const Plan &plan = (*plans)[i];
+        for (const Facility &facility : plan.getUnderConstruction()){
+            PendingRecord record = {facility.getTypeId(), facility.getCompletionTick()};
+            writer.write(&record, sizeof(record));
+        }
+    }
+    writer.padTo(header.sectionOffset[SECTION_SKIPPED]);
+    for (int i = 0; i < plans->size(); i++){
+        const Plan &plan = (*plans)[i];
+        const vector<long long> &skipped = plan.getSkippedOperational();
+        for (int typeId = 0; typeId < (int)skipped.size(); typeId++){
+            if (skipped[typeId] != 0){
+                SkippedRecord record = {typeId, 0, skipped[typeId]};
+                writer.write(&record, sizeof(record));
+            }
+        }
+    }
+    writer.padTo(header.fileSize);
+
+    header.checksum = writer.checksum;
+    bool written = writer.flush() && ::pwrite(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) && ::fdatasync(fd) == 0;
+    written = ::close(fd) == 0 && written;
+    if (!written || std::rename(tempPath.c_str(), filePath.c_str()) != 0){
+        *output << "Error: failed writing checkpoint " << filePath << '\n';
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    if (!Auxiliary::syncParentDirectory(filePath)){
+        *output << "Error: cannot sync the directory of checkpoint " << filePath << '\n';
+        return false;
+    }
+    return true;
+}
+
+// The header is not covered by the checksum, so its counts and offsets are checked on their own:
+// every section must be aligned and lie inside the file before any record is read
+static bool validLayout(const CheckpointHeader &header) {
+    for (int section = 0; section < NUM_SECTIONS; section++) {
+        uint64_t offset = header.sectionOffset[section];
+        if (offset % 8 != 0 || offset < sizeof(CheckpointHeader) || offset > header.fileSize
+            || header.sectionCount[section] > (header.fileSize - offset) / RECORD_SIZE[section]) {
+            return false;
+        }
+    }
+    return header.currentTick >= 0 && header.currentTick <= MAX_TICK && header.planCounter >= 0 && (uint64_t)header.planCounter == header.sectionCount[SECTION_PLANS];
+}
+
+// Checks that every record refers to something inside the checkpoint
+static bool validCheckpoint(const unsigned char *base, const CheckpointHeader &header) {
+    const SettlementRecord *settlements = reinterpret_cast<const SettlementRecord*>(base + header.sectionOffset[SECTION_SETTLEMENTS]);
+    const FacilityTypeRecord *types = reinterpret_cast<const FacilityTypeRecord*>(base + header.sectionOffset[SECTION_FACILITY_TYPES]);
+    const PlanRecord *plans = reinterpret_cast<const PlanRecord*>(base + header.sectionOffset[SECTION_PLANS]);
+    const FacilityCountRecord *operational = reinterpret_cast<const FacilityCountRecord*>(base + header.sectionOffset[SECTION_OPERATIONAL]);
+    const PendingRecord *pending = reinterpret_cast<const PendingRecord*>(base + header.sectionOffset[SECTION_PENDING]);
+    const SkippedRecord *skipped = reinterpret_cast<const SkippedRecord*>(base + header.sectionOffset[SECTION_SKIPPED]);
+    uint64_t stringsSize = header.sectionCount[SECTION_STRINGS];
+    int64_t numTypes = header.sectionCount[SECTION_FACILITY_TYPES];
+
+    for (uint64_t i = 0; i < header.sectionCount[SECTION_SETTLEMENTS]; i++) {
+        if ((uint64_t)settlements[i].nameOffset + settlements[i].nameLength > stringsSize || settlements[i].type < 0 || settlements[i].type > 2) {
+            return false;
+        }
+    }
+    for (int64_t i = 0; i < numTypes; i++) {
+        if ((uint64_t)types[i].nameOffset + types[i].nameLength > stringsSize || types[i].category < 0 || types[i].category > 2) {
+            return false;
+        }
+    }
+    for (uint64_t i = 0; i < header.sectionCount[SECTION_PLANS]; i++) {
+        const PlanRecord &plan = plans[i];
+        if (plan.planId != (int64_t)i || plan.settlement < 0 || (uint64_t)plan.settlement >= header.sectionCount[SECTION_SETTLEMENTS]
+            || plan.policy < POLICY_NAIVE || plan.policy > POLICY_SUSTAINABILITY || plan.status < 0 || plan.status > 1
+            || (uint64_t)plan.firstOperational + plan.numOperational > header.sectionCount[SECTION_OPERATIONAL]
+            || (uint64_t)plan.firstPending + plan.numPending > header.sectionCount[SECTION_PENDING]
+            || (uint64_t)plan.firstSkipped + plan.numSkipped > header.sectionCount[SECTION_SKIPPED]) {
+            return false;
+        }
+        if (plan.policy != POLICY_BALANCED && (plan.policyState[0] < 0 || (numTypes > 0 && plan.policyState[0] >= numTypes))) {
+            return false;
+        }
+    }
+    for (uint64_t i = 0; i < header.sectionCount[SECTION_OPERATIONAL]; i++) {
+        if (operational[i].typeId < 0 || operational[i].typeId >= numTypes || operational[i].count <= 0) {
+            return false;
+        }
+    }
+    for (uint64_t i = 0; i < header.sectionCount[SECTION_PENDING]; i++) {
+        if (pending[i].typeId < 0 || pending[i].typeId >= numTypes) {
+            return false;
+        }
+    }
+    for (uint64_t i = 0; i < header.sectionCount[SECTION_SKIPPED]; i++) {
+        if (skipped[i].typeId < 0 || skipped[i].typeId >= numTypes || skipped[i].count < 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+Replaces the world (settlements, facility options, plans and pending constructions) with the one
+stored in the checkpoint. The actions log is kept, the in-memory backup is dropped.
+*/
+bool Simulation::loadCheckpoint(const string &filePath){
+    STATS_TIMER(Phase::CHECKPOINT_LOAD);
+    MappedFile file;
+    if (!file.open(filePath)){
+        *output << "Error: cannot open checkpoint " << filePath << '\n';
+        return false;
+    }
+    size_t fileSize = file.size();
+    if (fileSize < sizeof(CheckpointHeader)){
+        *output << "Error: " << filePath << " is not a checkpoint" << '\n';
+        return false;
+    }
+    const unsigned char *base = reinterpret_cast<const unsigned char*>(file.data());
+
+    CheckpointHeader header;
+    std::memcpy(&header, base, sizeof(header));
+    string problem;
+    if (std::memcmp(header.magic, CHECKPOINT_MAGIC, sizeof(header.magic)) != 0){
+        problem = "is not a checkpoint";
+    } else if (header.version != CHECKPOINT_VERSION || header.headerSize != sizeof(CheckpointHeader)){
+        problem = "has an unsupported checkpoint version";
+    } else if (header.fileSize != fileSize){
+        problem = "is truncated";
+    } else if (!validLayout(header)){
+        problem = "has an invalid header";
+    } else if (Auxiliary::fnv1a(base + sizeof(header), fileSize - sizeof(header)) != header.checksum){
+        problem = "is corrupted (checksum mismatch)";
+    } else if (!validCheckpoint(base, header)){
+        problem = "has inconsistent records";
+    }
+    if (!problem.empty()){
+        *output << "Error: " << filePath << " " << problem << '\n';
+        return false;
+    }
+
+    const char *strings = reinterpret_cast<const char*>(base + header.sectionOffset[SECTION_STRINGS]);
+    const SettlementRecord *settlementRecords = reinterpret_cast<const SettlementRecord*>(base + header.sectionOffset[SECTION_SETTLEMENTS]);
+    const FacilityTypeRecord *typeRecords = reinterpret_cast<const FacilityTypeRecord*>(base + header.sectionOffset[SECTION_FACILITY_TYPES]);
+    const PlanRecord *planRecords = reinterpret_cast<const PlanRecord*>(base + header.sectionOffset[SECTION_PLANS]);
+    const FacilityCountRecord *operational = reinterpret_cast<const FacilityCountRecord*>(base + header.sectionOffset[SECTION_OPERATIONAL]);
+    const PendingRecord *pending = reinterpret_cast<const PendingRecord*>(base + header.sectionOffset[SECTION_PENDING]);
+    const SkippedRecord *skipped = reinterpret_cast<const SkippedRecord*>(base + header.sectionOffset[SECTION_SKIPPED]);
+
+    if (backup != nullptr){
+        delete backup;
+        backup = nullptr;
+    }
+    plans = std::make_shared<PlanStore>();
+    scheduler = std::make_shared<ConstructionScheduler>();
+    for (Settlement *settlement : settlements){
+        delete settlement;
+    }
+    settlements.clear();
+    facilitiesOptions.clear();
+
+    for (uint64_t i = 0; i < header.sectionCount[SECTION_SETTLEMENTS]; i++){
+        const SettlementRecord &record = settlementRecords[i];
+        settlements.push_back(new Settlement(string(strings + record.nameOffset, record.nameLength), (SettlementType)record.type));
+    }
+    settlementIndex.rebuild(settlements);
+    for (uint64_t i = 0; i < header.sectionCount[SECTION_FACILITY_TYPES]; i++){
+        const FacilityTypeRecord &record = typeRecords[i];
+        facilitiesOptions.add(FacilityType(string(strings + record.nameOffset, record.nameLength), (FacilityCategory)record.category, record.price, record.lifeQualityScore, record.economyScore, record.environmentScore));
+    }
+
+    PlanStore &planList = *plans;
+    planList.reserve(header.sectionCount[SECTION_PLANS]);
+    planSettlements.clear();
+    for (uint64_t i = 0; i < header.sectionCount[SECTION_PLANS]; i++){
+        const PlanRecord &record = planRecords[i];
+        const Settlement &settlement = *settlements[record.settlement];
+        Plan plan(record.planId, settlement, makePolicy(record.policy, record.policyState), facilitiesOptions);
+        plan.restoreState((PlanStatus)record.status, record.lifeQualityScore, record.economyScore, record.environmentScore);
+        for (uint32_t k = record.firstOperational; k < record.firstOperational + record.numOperational; k++){
+            plan.restoreRun(operational[k].typeId, operational[k].count);
+        }
+        for (uint32_t k = record.firstPending; k < record.firstPending + record.numPending; k++){
+            plan.restoreFacility(pending[k].typeId, FacilityStatus::UNDER_CONSTRUCTIONS, pending[k].completionTick);
+            scheduler->schedule(pending[k].completionTick, i);
+        }
+        for (uint32_t k = record.firstSkipped; k < record.firstSkipped + record.numSkipped; k++){
+            plan.restoreSkipped(skipped[k].typeId, skipped[k].count);
+        }
+        plan.setCompactHistory(compactHistory);
+        planList.add(std::move(plan));
+        planSettlements.push_back(record.settlement);
+    }
+    rebuildScoreTotals();
+    planRanking.invalidate();
+    planCounter = header.planCounter;
+    currentTick = header.currentTick;
+    return true;
+}
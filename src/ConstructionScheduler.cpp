@@ -0,0 +1,26 @@
+#include "../include/ConstructionScheduler.h"
+
+ConstructionScheduler::ConstructionScheduler() {}
+
+void ConstructionScheduler::schedule(int completionTick, int planIndex) {
+    pending.emplace(completionTick, planIndex);
+}
+
+// Appends the index of every plan with a facility completing at or before currentTick
+void ConstructionScheduler::popDue(int currentTick, vector<int> &planIndexes) {
+    while (!pending.empty() && pending.top().first <= currentTick) {
+        int planIndex = pending.top().second;
+        pending.pop();
+        if (planIndexes.empty() || planIndexes.back() != planIndex) {
+            planIndexes.push_back(planIndex);
+        }
+    }
+}
+
+int ConstructionScheduler::size() const {
+    return pending.size();
+}
+
+void ConstructionScheduler::clear() {
+    pending = std::priority_queue<std::pair<int, int>, vector<std::pair<int, int>>, std::greater<std::pair<int, int>>>();
+}
@@ -37,64 +37,16 @@ FacilityCategory FacilityType::getCategory() const {
     return category;
 }
 
-// Facility class implementation
-Facility::Facility(const string &name, const string &settlementName, int category, const int price, const int lifeQuality_score, const int economy_score, const int environment_score)
-    : FacilityType(name, intToFacilityCategory(category), price, lifeQuality_score, economy_score, environment_score), settlementName(settlementName), status(FacilityStatus::UNDER_CONSTRUCTIONS), timeLeft(3) {}
+Facility::Facility(int typeId, int completionTick) : typeId(typeId), completionTick(completionTick) {}
 
-Facility::Facility(const FacilityType &type, const string &settlementName)
-    : FacilityType(type), settlementName(settlementName), status(FacilityStatus::UNDER_CONSTRUCTIONS), timeLeft(price) {}
-
-const string &Facility::getSettlementName() const {
-    return settlementName;
-}
-
-const int Facility::getTimeLeft() const {
-    return timeLeft;
-}
-
-FacilityStatus Facility::step() {
-    if (status == FacilityStatus::UNDER_CONSTRUCTIONS) {
-        timeLeft--;
-        if (timeLeft == 0) {
-            status = FacilityStatus::OPERATIONAL;
-        }
-    }
-    return status;
+int Facility::getTypeId() const {
+    return typeId;
 }
 
-void Facility::setStatus(FacilityStatus status) {
-    this->status = status;
+int Facility::getCompletionTick() const {
+    return completionTick;
 }
 
-const FacilityStatus& Facility::getStatus() const {
-    return status;
+void Facility::setCompletionTick(int tick) {
+    completionTick = tick;
 }
-
-const string Facility::toString() const {
-    string statusStr = (status == FacilityStatus::UNDER_CONSTRUCTIONS) ? "UNDER_CONSTRUCTIONS" : "OPERATIONAL";
-    return "Facility: " + getName() + " in " + getSettlementName() + " is " + statusStr + " and has " + std::to_string(getTimeLeft()) + " time left";
-}
-
-FacilityCategory Facility::intToFacilityCategory(int category) {
-    switch (category) {
-        case 0:
-            return FacilityCategory::LIFE_QUALITY;
-        case 1:
-            return FacilityCategory::ECONOMY;
-        case 2:
-            return FacilityCategory::ENVIRONMENT;
-        default:
-            return FacilityCategory::LIFE_QUALITY;
-    }
-}
-
-string Facility::statusToString() const {
-    switch (status) {
-        case FacilityStatus::UNDER_CONSTRUCTIONS:
-            return "UNDER_CONSTRUCTIONS";
-        case FacilityStatus::OPERATIONAL:
-            return "OPERATIONAL";
-        default:
-            return "UNKNOWN";
-    }
-}
\ No newline at end of file
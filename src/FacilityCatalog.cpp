@@ -0,0 +1,165 @@
+#include "../include/FacilityCatalog.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+FacilityCatalog::FacilityCatalog() {}
+
+FacilityCatalog::FacilityCatalog(const FacilityCatalog &other)
+    : types(other.types), lifeQualityScores(other.lifeQualityScores), economyScores(other.economyScores), environmentScores(other.environmentScores) {
+    for (int category = 0; category < 3; category++) {
+        categoryIndexes[category] = other.categoryIndexes[category];
+    }
+}
+
+// FacilityType has const members, so the types are rebuilt rather than assigned
+FacilityCatalog &FacilityCatalog::operator=(const FacilityCatalog &other) {
+    if (this == &other) {
+        return *this;
+    }
+    clear();
+    for (const FacilityType &type : other.types) {
+        add(type);
+    }
+    return *this;
+}
+
+bool FacilityCatalog::add(const FacilityType &type) {
+    if ((int)type.getCategory() < 0 || (int)type.getCategory() > 2) {
+        return false;
+    }
+    categoryIndexes[(int)type.getCategory()].push_back(types.size());
+    types.push_back(type);
+    lifeQualityScores.push_back(type.getLifeQualityScore());
+    economyScores.push_back(type.getEconomyScore());
+    environmentScores.push_back(type.getEnvironmentScore());
+    return true;
+}
+
+void FacilityCatalog::clear() {
+    types.clear();
+    lifeQualityScores.clear();
+    economyScores.clear();
+    environmentScores.clear();
+    for (int category = 0; category < 3; category++) {
+        categoryIndexes[category].clear();
+    }
+}
+
+// Drops every type added after the first newSize ones
+void FacilityCatalog::truncate(int newSize) {
+    while ((int)types.size() > newSize) {
+        types.pop_back();
+    }
+    lifeQualityScores.resize(types.size());
+    economyScores.resize(types.size());
+    environmentScores.resize(types.size());
+    for (int category = 0; category < 3; category++) {
+        while (!categoryIndexes[category].empty() && categoryIndexes[category].back() >= newSize) {
+            categoryIndexes[category].pop_back();
+        }
+    }
+}
+
+vector<FacilityType>::const_iterator FacilityCatalog::begin() const {
+    return types.begin();
+}
+
+vector<FacilityType>::const_iterator FacilityCatalog::end() const {
+    return types.end();
+}
+
+const vector<int> &FacilityCatalog::getCategoryIndexes(FacilityCategory category) const {
+    return categoryIndexes[(int)category];
+}
+
+/*
+Returns the first catalog index at or after fromIndex (wrapping around) whose type is in the
+given category, or -1 if the category is empty. This is the facility a round-robin scan of the
+catalog starting at fromIndex would find.
+cursor is the caller's position in the category list from the previous call; the answer is
+almost always the entry right after it, so the lookup is O(1) and only falls back to a binary
+search when the hint is stale (e.g. a different fromIndex or a grown catalog).
+*/
+int FacilityCatalog::nextInCategory(FacilityCategory category, int fromIndex, int &cursor) const {
+    const vector<int> &indexes = categoryIndexes[(int)category];
+    if (indexes.empty()) {
+        return -1;
+    }
+    int count = indexes.size();
+    int position = cursor + 1;
+    bool valid = position >= 0 && position <= count
+                 && (position == count || indexes[position] >= fromIndex)
+                 && (position == 0 || indexes[position - 1] < fromIndex);
+    if (!valid && fromIndex <= indexes[0]) {
+        position = 0; //The scan wrapped around the catalog
+    } else if (!valid) {
+        position = std::lower_bound(indexes.begin(), indexes.end(), fromIndex) - indexes.begin();
+    }
+    if (position == count) {
+        position = 0;
+    }
+    cursor = position;
+    return indexes[position];
+}
+
+typedef int int4 __attribute__((vector_size(16)));
+
+/*
+Returns the first catalog index whose scores, added to the given ones, have the smallest
+spread between the highest and the lowest score (the BalancedSelection rule), or -1 for an
+empty catalog. Four facility types are scored per iteration; each lane keeps its own first
+minimum and the lanes are merged at the end, so ties still go to the lowest index.
+*/
+int FacilityCatalog::mostBalanced(int lifeQualityScore, int economyScore, int environmentScore) const {
+    int count = types.size();
+    int bestDifference = INT_MAX;
+    int bestIndex = -1;
+    int i = 0;
+
+    if (count >= 4) {
+        int4 lifeQualityBase = {lifeQualityScore, lifeQualityScore, lifeQualityScore, lifeQualityScore};
+        int4 economyBase = {economyScore, economyScore, economyScore, economyScore};
+        int4 environmentBase = {environmentScore, environmentScore, environmentScore, environmentScore};
+        int4 laneDifference = {INT_MAX, INT_MAX, INT_MAX, INT_MAX};
+        int4 laneIndex = {-1, -1, -1, -1};
+        int4 index = {0, 1, 2, 3};
+        int4 step = {4, 4, 4, 4};
+        for (; i + 4 <= count; i += 4) {
+            int4 lifeQuality, economy, environment;
+            std::memcpy(&lifeQuality, &lifeQualityScores[i], sizeof(int4));
+            std::memcpy(&economy, &economyScores[i], sizeof(int4));
+            std::memcpy(&environment, &environmentScores[i], sizeof(int4));
+            lifeQuality += lifeQualityBase;
+            economy += economyBase;
+            environment += environmentBase;
+            int4 high = lifeQuality > economy ? lifeQuality : economy;
+            high = high > environment ? high : environment;
+            int4 low = lifeQuality < economy ? lifeQuality : economy;
+            low = low < environment ? low : environment;
+            int4 difference = high - low;
+            int4 better = difference < laneDifference;
+            laneDifference = better ? difference : laneDifference;
+            laneIndex = better ? index : laneIndex;
+            index += step;
+        }
+        for (int lane = 0; lane < 4; lane++) {
+            if (laneDifference[lane] < bestDifference || (laneDifference[lane] == bestDifference && laneIndex[lane] < bestIndex)) {
+                bestDifference = laneDifference[lane];
+                bestIndex = laneIndex[lane];
+            }
+        }
+    }
+
+    for (; i < count; i++) {
+        int lifeQuality = lifeQualityScores[i] + lifeQualityScore;
+        int economy = economyScores[i] + economyScore;
+        int environment = environmentScores[i] + environmentScore;
+        int difference = std::max({lifeQuality, economy, environment}) - std::min({lifeQuality, economy, environment});
+        if (difference < bestDifference) {
+            bestDifference = difference;
+            bestIndex = i;
+        }
+    }
+    return bestIndex;
+}
@@ -0,0 +1,58 @@
+#include "../include/LineReader.h"
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+
+static const size_t READ_BUFFER_SIZE = 1 << 20;
+
+LineReader::LineReader(int fd) : fd(fd), buffer(READ_BUFFER_SIZE), begin(0), end(0), atEnd(false) {}
+
+bool LineReader::next(std::string_view &line) {
+    size_t searchFrom = begin;
+    while (true) {
+        const char *newline = static_cast<const char*>(std::memchr(buffer.data() + searchFrom, '\n', end - searchFrom));
+        if (newline != nullptr) {
+            size_t lineEnd = newline - buffer.data();
+            line = std::string_view(buffer.data() + begin, lineEnd - begin);
+            begin = lineEnd + 1;
+            return true;
+        }
+        if (atEnd) {
+            if (begin == end) {
+                return false;
+            }
+            // Last line without a trailing newline
+            line = std::string_view(buffer.data() + begin, end - begin);
+            begin = end;
+            return true;
+        }
+        searchFrom = end - begin;
+        if (!fill()) {
+            atEnd = true;
+        }
+        searchFrom = begin + searchFrom;
+    }
+}
+
+// Moves the unread data to the front and reads more after it; false at end of input
+bool LineReader::fill() {
+    if (begin > 0) {
+        std::memmove(buffer.data(), buffer.data() + begin, end - begin);
+        end -= begin;
+        begin = 0;
+    }
+    if (end == buffer.size()) { //A line longer than the buffer
+        buffer.resize(buffer.size() * 2);
+    }
+    while (true) {
+        ssize_t bytesRead = ::read(fd, buffer.data() + end, buffer.size() - end);
+        if (bytesRead < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytesRead <= 0) {
+            return false;
+        }
+        end += bytesRead;
+        return true;
+    }
+}
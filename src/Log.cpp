@@ -0,0 +1,140 @@
+#include "../include/Log.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cerrno>
+#include <unistd.h>
+
+std::atomic<int> Log::currentLevel((int)LogLevel::INFO);
+
+static const char *const LEVEL_NAMES[] = {"trace", "debug", "info", "error", "off"};
+static const char *const LEVEL_PREFIXES[] = {"[TRACE] ", "[DEBUG] ", "[INFO] ", "[ERROR] ", ""};
+static const size_t MAX_PENDING_BYTES = 16 << 20; //Writers wait for the sink beyond this
+
+/*
+The sink behind Log::write: producers append to pending, the writer thread swaps it out and
+writes it to stderr outside the lock. queuedBytes/writtenBytes let flush() wait for a point
+in the stream instead of for an empty queue.
+*/
+struct LogSink {
+    std::mutex mutex;
+    std::condition_variable hasPending;
+    std::condition_variable hasWritten;
+    string pending;
+    unsigned long long queuedBytes = 0;
+    unsigned long long writtenBytes = 0;
+    std::thread writer;
+    bool started = false;
+    bool stopping = false;
+
+    ~LogSink() {
+        stop();
+    }
+
+    void run() {
+        string chunk;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            hasPending.wait(lock, [this] { return stopping || !pending.empty(); });
+            if (pending.empty()) {
+                return;
+            }
+            chunk.swap(pending);
+            lock.unlock();
+            writeAll(chunk);
+            lock.lock();
+            writtenBytes += chunk.size();
+            chunk.clear();
+            hasWritten.notify_all();
+        }
+    }
+
+    static void writeAll(const string &chunk) {
+        const char *data = chunk.data();
+        size_t size = chunk.size();
+        while (size > 0) {
+            ssize_t written = ::write(STDERR_FILENO, data, size);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return; //Nowhere to log to, drop it
+            }
+            data += written;
+            size -= written;
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!started) {
+                return;
+            }
+            stopping = true;
+        }
+        hasPending.notify_one();
+        writer.join();
+        started = false;
+        stopping = false;
+    }
+};
+
+static LogSink sink;
+
+void Log::setLevel(LogLevel level) {
+    currentLevel.store((int)level, std::memory_order_relaxed);
+}
+
+LogLevel Log::getLevel() {
+    return (LogLevel)currentLevel.load(std::memory_order_relaxed);
+}
+
+bool Log::parseLevel(std::string_view name, LogLevel &level) {
+    for (int i = 0; i <= (int)LogLevel::OFF; i++) {
+        if (name == LEVEL_NAMES[i]) {
+            level = (LogLevel)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Log::write(LogLevel level, const string &message) {
+    std::unique_lock<std::mutex> lock(sink.mutex);
+    if (!sink.started) {
+        sink.writer = std::thread(&LogSink::run, &sink);
+        sink.started = true;
+    }
+    sink.hasWritten.wait(lock, [] { return sink.pending.size() < MAX_PENDING_BYTES; });
+    bool wasEmpty = sink.pending.empty();
+    size_t before = sink.pending.size();
+    sink.pending += LEVEL_PREFIXES[(int)level];
+    sink.pending += message;
+    sink.pending += '\n';
+    sink.queuedBytes += sink.pending.size() - before;
+    if (wasEmpty) {
+        sink.hasPending.notify_one();
+    }
+}
+
+void Log::flush() {
+    std::unique_lock<std::mutex> lock(sink.mutex);
+    unsigned long long target = sink.queuedBytes;
+    sink.hasWritten.wait(lock, [target] { return !sink.started || sink.writtenBytes >= target; });
+}
+
+void Log::shutdown() {
+    sink.stop();
+}
+
+// One formatting buffer per thread, reused by every message it logs
+static thread_local std::ostringstream lineBuffer;
+
+LogLine::LogLine(LogLevel level) : level(level), stream(lineBuffer) {
+    stream.str(string());
+}
+
+LogLine::~LogLine() {
+    Log::write(level, stream.str());
+}
@@ -0,0 +1,53 @@
+#include "../include/MappedFile.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+MappedFile::MappedFile() : mapping(nullptr), length(0) {}
+
+MappedFile::~MappedFile() {
+    unmap();
+}
+
+bool MappedFile::open(const string &filePath) {
+    unmap();
+    int fd = ::open(filePath.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    // An empty file cannot be mapped, it is simply an empty range
+    if (info.st_size > 0) {
+        void *address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED) {
+            ::close(fd);
+            return false;
+        }
+        mapping = address;
+        length = info.st_size;
+        madvise(mapping, length, MADV_SEQUENTIAL); //Both users read the file front to back
+    }
+    ::close(fd);
+    return true;
+}
+
+const char *MappedFile::data() const {
+    return static_cast<const char*>(mapping);
+}
+
+size_t MappedFile::size() const {
+    return length;
+}
+
+void MappedFile::unmap() {
+    if (mapping != nullptr) {
+        munmap(mapping, length);
+        mapping = nullptr;
+        length = 0;
+    }
+}
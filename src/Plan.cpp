@@ -2,36 +2,30 @@
 #include <vector>
 #include <iostream>
 #include <algorithm>
+#include <map>
 using std::string;
 using std::vector;
 #include "../include/Plan.h"
 #include "../include/Facility.h" // Include the full definition of Facility
+#include "../include/Log.h"
+#include "../include/Stats.h"
+#include "../include/Trace.h"
 
-Plan::Plan(const int planId, const Settlement &settlement, SelectionPolicy *selectionPolicy, const vector<FacilityType> &facilityOptions)
-    : plan_id(planId), settlement(settlement), selectionPolicy(selectionPolicy), status(PlanStatus::AVALIABLE), facilityOptions(facilityOptions), life_quality_score(0), economy_score(0), environment_score(0){
-    std::cout << "Plan created with selectionPolicy: " << selectionPolicy << std::endl;
+Plan::Plan(const int planId, const Settlement &settlement, const PlanPolicy &selectionPolicy, const FacilityCatalog &facilityOptions)
+    : plan_id(planId), settlement(&settlement), selectionPolicy(selectionPolicy), status(PlanStatus::AVALIABLE), compactHistory(false), facilityOptions(&facilityOptions), life_quality_score(0), economy_score(0), environment_score(0){
+    LOG_DEBUG("Plan " << planId << " created with selectionPolicy: " << selectionPolicy.toString());
 }
 
-Plan::~Plan()
+const Settlement &Plan::getSettlement() const
 {
-    for (Facility *facility : facilities)
-    {
-        delete facility;
-    }
-    for (Facility *facility : underConstruction)
-    {
-        delete facility;
-    }
-
-    if (selectionPolicy != nullptr)
-    {
-        delete selectionPolicy;
-    }
+    return *settlement;
 }
 
-const Settlement &Plan::getSettlement() const
+// Points the plan at a copied simulation's settlement and facility options
+void Plan::rebind(const Settlement &settlement, const FacilityCatalog &facilityOptions)
 {
-    return settlement;
+    this->settlement = &settlement;
+    this->facilityOptions = &facilityOptions;
 }
 
 const int Plan::getPlanId() const
@@ -39,33 +33,34 @@ const int Plan::getPlanId() const
     return plan_id;
 }
 
-const int Plan::getlifeQualityScore() const
+const long long Plan::getlifeQualityScore() const
 {
     return life_quality_score;
 }
 
-const int Plan::getEconomyScore() const
+const long long Plan::getEconomyScore() const
 {
     return economy_score;
 }
 
-const int Plan::getEnvironmentScore() const
+const long long Plan::getEnvironmentScore() const
 {
     return environment_score;
 }   
 
-void Plan::setSelectionPolicy(SelectionPolicy *selectionPolicy)
+void Plan::setSelectionPolicy(const PlanPolicy &selectionPolicy)
 {
-    if(this->selectionPolicy != nullptr)
-    {
-        delete this->selectionPolicy;
-    }
     this->selectionPolicy = selectionPolicy;
 }
 
+const PlanPolicy &Plan::getSelectionPolicy() const
+{
+    return selectionPolicy;
+}
+
 const PlanStatus Plan::getStatus() const
 {
-    if ((int)settlement.getType()+1 - underConstruction.size() > 0 )
+    if ((int)settlement->getType()+1 - underConstruction.size() > 0 )
     {
         return PlanStatus::AVALIABLE;
     }
@@ -75,51 +70,222 @@ const PlanStatus Plan::getStatus() const
     }
 }
 
-void Plan::addFacility(Facility* facility)
+// Starts building a facility; its scores count from the tick it is selected in
+void Plan::addFacility(const Facility &facility)
 {
+    const FacilityType &type = (*facilityOptions)[facility.getTypeId()];
     underConstruction.push_back(facility);
-    facility->setStatus(FacilityStatus::UNDER_CONSTRUCTIONS);
-    life_quality_score += facility->getLifeQualityScore();
-    economy_score += facility->getEconomyScore();
-    environment_score += facility->getEnvironmentScore();
+    life_quality_score += type.getLifeQualityScore();
+    economy_score += type.getEconomyScore();
+    environment_score += type.getEnvironmentScore();
+}
+
+int Plan::step(int currentTick){
+    return step(currentTick, -1);
+}
+
+// tick + ticks, or MAX_TICK + 1 (never) if that is past the last tick
+static int completionTickAfter(int tick, long long ticks){
+    return (int)std::min<long long>(tick + ticks, (long long)MAX_TICK + 1);
+}
+
+/*
+The body of step for a plan that is available and uses a Policy. Simulation::step calls it
+directly for each group of plans sharing a policy type, so the policy's selectFacility is
+inlined here instead of dispatched per plan. selectedTypeId is the batch's choice or -1, and is
+set to the type of the facility started.
+*/
+template <typename Policy>
+int Plan::stepWith(int currentTick, int &selectedTypeId){
+    STATS_SAMPLED_TIMER(Phase::PLAN_STEP);
+    TRACE_SCOPE("plan_step", plan_id);
+    this-> status = PlanStatus::AVALIABLE;
+    LOG_TRACE("Plan " << plan_id << " selecting from " << facilityOptions->size() << " facility options with " << selectionPolicy.toString());
+    const FacilityType *selected = selectedTypeId != -1 ? &(*facilityOptions)[selectedTypeId] : nullptr;
+    if (selected == nullptr) {
+        STATS_SAMPLED_TIMER(Phase::SELECT_FACILITY);
+        TRACE_SCOPE("select_facility", plan_id);
+        selected = &selectionPolicy.get<Policy>().selectFacility(*facilityOptions);
+    }
+    const FacilityType &selectedFacilityType = *selected;
+    LOG_TRACE("Plan " << plan_id << " selected " << selectedFacilityType.getName());
+    // A facility is built during the tick it was selected in, so it is ready price-1 ticks later
+    int buildTime = selectedFacilityType.getCost() > 0 ? selectedFacilityType.getCost() : 1;
+    selectedTypeId = &selectedFacilityType - &(*facilityOptions)[0];
+    Facility selectedFacility(selectedTypeId, completionTickAfter(currentTick, buildTime - 1));
+    this -> addFacility(selectedFacility);
+    return selectedFacility.getCompletionTick();
 }
 
-void Plan::step(){
-    std::cout << "Plan::step() called" << std::endl;
-    std::cout << "Plan status: " << statusToString() << std::endl;
+template int Plan::stepWith<NaiveSelection>(int currentTick, int &selectedTypeId);
+template int Plan::stepWith<BalancedSelection>(int currentTick, int &selectedTypeId);
+template int Plan::stepWith<EconomySelection>(int currentTick, int &selectedTypeId);
+template int Plan::stepWith<SustainabilitySelection>(int currentTick, int &selectedTypeId);
+template int Plan::stepWith<CustomSelection>(int currentTick, int &selectedTypeId);
+
+// Selects and starts a new facility if the plan has room for one. selectedTypeId is the
+// choice made for this plan by the SelectionBatch, or -1 to ask the selection policy.
+// Returns the tick at which the started facility completes, or -1 if nothing was started.
+// Completions are driven by the simulation's ConstructionScheduler (see completeFacilities).
+int Plan::step(int currentTick, int selectedTypeId){
+    LOG_TRACE("Plan " << plan_id << " step, status: " << statusToString());
 
-    if (this-> getStatus() == PlanStatus::AVALIABLE){
-        this-> status = PlanStatus::AVALIABLE;
-        if (selectionPolicy == nullptr) {
+    if (this-> getStatus() != PlanStatus::AVALIABLE){
+        return -1;
+    }
+    switch (selectionPolicy.getKind()){
+        case PolicyKind::NAIVE:
+            return stepWith<NaiveSelection>(currentTick, selectedTypeId);
+        case PolicyKind::BALANCED:
+            return stepWith<BalancedSelection>(currentTick, selectedTypeId);
+        case PolicyKind::ECONOMY:
+            return stepWith<EconomySelection>(currentTick, selectedTypeId);
+        case PolicyKind::SUSTAINABILITY:
+            return stepWith<SustainabilitySelection>(currentTick, selectedTypeId);
+        case PolicyKind::CUSTOM:
+            return stepWith<CustomSelection>(currentTick, selectedTypeId);
+        default:
             std::cerr << "Error: selectionPolicy is null" << std::endl;
-            return;
-        }
-        std::cout << "Selecting facility..." << std::endl;
-        std::cout << "Number of facility options: " << facilityOptions.size() << std::endl;
-        for (const auto& facility : facilityOptions) {
-            std::cout << "Facility: " << facility.getName() << std::endl;
-        }
-        std::cout << "selectionPolicy address: " << selectionPolicy << std::endl;
-        const FacilityType &selectedFacilityType = selectionPolicy->selectFacility(facilityOptions);
-        std::cout << "Facility selected: " << selectedFacilityType.getName() << std::endl;
-        Facility* selectedFacility = new Facility(selectedFacilityType, settlement.getName());
-        this -> addFacility(selectedFacility);
-    }
-
-    int count = 0;
-    for (Facility *facility : underConstruction){   
-        facility -> step();
-        if (facility->getStatus() == FacilityStatus::OPERATIONAL){
-            facilities.push_back(facility);
-            underConstruction.erase(underConstruction.begin() + count);
+            return -1;
+    }
+}
+
+// Moves every facility whose construction ends at or before currentTick to the operational ones
+void Plan::completeFacilities(int currentTick){
+    STATS_SAMPLED_TIMER(Phase::FACILITY_STEP);
+    moveCompleted(currentTick);
+    if (compactHistory){
+        foldRuns();
+    }
+}
+
+void Plan::moveCompleted(int currentTick){
+    auto it = underConstruction.begin();
+    while (it != underConstruction.end()){
+        if (it->getCompletionTick() <= currentTick){
+            appendRun(it->getTypeId(), 1);
+            it = underConstruction.erase(it);
         }
         else{
-            count++;
-        }   
+            ++it;
+        }
+    }
+}
+
+// Keeps only per-type counts of the operational facilities, forgetting their order
+void Plan::foldRuns(){
+    if (operationalRuns.empty()){
+        return;
+    }
+    if (skippedOperational.size() < facilityOptions->size()){
+        skippedOperational.resize(facilityOptions->size(), 0);
+    }
+    for (const FacilityRun &run : operationalRuns){
+        skippedOperational[run.typeId] += run.count;
     }
+    operationalRuns.clear();
+}
+
+/*
+With compact history a plan's memory depends on the catalog size only, not on how long it ran:
+operational facilities are counted per type, and planStatus lists them grouped by type instead
+of in the order they were completed.
+*/
+void Plan::setCompactHistory(bool compact){
+    compactHistory = compact;
+    if (compactHistory){
+        foldRuns();
+    }
+}
+
+// Called at the end of a tick in which the plan started a facility
+void Plan::updateStatus(){
     if (this-> getStatus() == PlanStatus::BUSY){
         this-> status = PlanStatus::BUSY;
-        return;
+    }
+}
+
+// One simulation tick for this plan alone, in the same order Simulation::step uses.
+// Runs are not folded here, fastForward measures periods on them.
+void Plan::advance(int currentTick){
+    bool started = step(currentTick) != -1;
+    moveCompleted(currentTick);
+    if (started){
+        updateStatus();
+    }
+}
+
+// Everything that decides the plan's future: policy state, status and the relative
+// completion time and type of each facility under construction
+void Plan::cycleSignature(int currentTick, vector<int> &signature) const{
+    signature.clear();
+    signature.push_back(selectionPolicy.getCycleState());
+    signature.push_back((int)status);
+    for (const Facility &facility : underConstruction){
+        signature.push_back(facility.getCompletionTick() - currentTick);
+        signature.push_back(facility.getTypeId());
+    }
+}
+
+static const int CYCLE_SEARCH_LIMIT = 1 << 16;
+static const int HISTORY_FIELDS = 5;
+
+/*
+Advances the plan from currentTick to targetTick on its own (the caller reschedules the
+under-construction facilities afterwards). With a fixed catalog the built-in policies are
+periodic, so once the plan's state repeats, whole periods are added analytically: scores grow
+by the per-period delta and the facilities completed in a period are counted per type instead
+of being created. The result is the same as stepping tick by tick.
+*/
+void Plan::fastForward(int currentTick, int targetTick){
+    std::map<vector<int>, int> seen; //signature -> tick it was seen at
+    vector<int> signature;
+    vector<long long> history; //per tick: life quality, economy, environment, number of runs, length of the last run
+    bool searching = selectionPolicy.getCycleState() >= 0;
+    int tick = currentTick;
+
+    while (searching){
+        cycleSignature(tick, signature);
+        auto found = seen.find(signature);
+        if (found != seen.end()){
+            int period = tick - found->second;
+            long long periods = (targetTick - tick) / period;
+            const long long *start = &history[HISTORY_FIELDS * (found->second - currentTick)];
+            life_quality_score += periods * (life_quality_score - start[0]);
+            economy_score += periods * (economy_score - start[1]);
+            environment_score += periods * (environment_score - start[2]);
+            if (skippedOperational.size() < facilityOptions->size()){
+                skippedOperational.resize(facilityOptions->size(), 0);
+            }
+            // The facilities completed in one period: the rest of the run that was last at the
+            // start of the period and every run after it
+            for (int i = start[3] > 0 ? start[3] - 1 : 0; i < (int)operationalRuns.size(); i++){
+                long long completed = operationalRuns[i].count - (i == start[3] - 1 ? start[4] : 0);
+                skippedOperational[operationalRuns[i].typeId] += periods * completed;
+            }
+            for (Facility &facility : underConstruction){
+                facility.setCompletionTick(completionTickAfter(facility.getCompletionTick(), periods * period));
+            }
+            tick += periods * period;
+            break;
+        }
+        if (tick == targetTick || (int)seen.size() == CYCLE_SEARCH_LIMIT){
+            break;
+        }
+        seen.emplace(signature, tick);
+        history.push_back(life_quality_score);
+        history.push_back(economy_score);
+        history.push_back(environment_score);
+        history.push_back(operationalRuns.size());
+        history.push_back(operationalRuns.empty() ? 0 : operationalRuns.back().count);
+        advance(++tick);
+    }
+
+    while (tick < targetTick){
+        advance(++tick);
+    }
+    if (compactHistory){
+        foldRuns();
     }
 }
 
@@ -135,29 +301,106 @@ string Plan::statusToString() const
     }
 }
 
-void Plan::printStatus()
+void Plan::printStatus(std::ostream &out)
 {
-    std::cout << "PlanID " << plan_id << std::endl;
-    std::cout << "SettlementName: " << settlement.getName() << std::endl;
-    std::cout << "PlanStatus: " << this->statusToString() << std::endl;
-    std::cout << "SelectionPolicy: " << selectionPolicy->toString() << std::endl;
-    std::cout << "LifeQualityscore: " << life_quality_score << std::endl;
-    std::cout << "EconomyScore: " << economy_score << std::endl;
-    std::cout << "EnvironmentScore: " << environment_score << std::endl;
+    out << "PlanID " << plan_id << '\n';
+    out << "SettlementName: " << settlement->getName() << '\n';
+    out << "PlanStatus: " << this->statusToString() << '\n';
+    out << "SelectionPolicy: " << selectionPolicy.toString() << '\n';
+    out << "LifeQualityscore: " << life_quality_score << '\n';
+    out << "EconomyScore: " << economy_score << '\n';
+    out << "EnvironmentScore: " << environment_score << '\n';
     
-    for (Facility *facility : facilities)
+    // Runs are expanded only here
+    for (const FacilityRun &run : operationalRuns)
+    {
+        const string &name = (*facilityOptions)[run.typeId].getName();
+        for (int i = 0; i < run.count; i++)
+        {
+            out << "FacilityName: "<< name<< '\n';
+            out << "FacilityStatus: OPERATIONAL" << '\n';
+        }
+    }
+    for (int typeId = 0; typeId < (int)skippedOperational.size(); typeId++)
+    {
+        for (long long i = 0; i < skippedOperational[typeId]; i++)
+        {
+            out << "FacilityName: "<< (*facilityOptions)[typeId].getName()<< '\n';
+            out << "FacilityStatus: OPERATIONAL" << '\n';
+        }
+    }
+    for (const Facility &facility : underConstruction)
+    {
+        out << "FacilityName: "<< (*facilityOptions)[facility.getTypeId()].getName()<< '\n';
+        out << "FacilityStatus: UNDER_CONSTRUCTIONS" << '\n';
+    }
+}
+
+const vector<FacilityRun>& Plan::getOperationalRuns() const
+{
+    return operationalRuns;
+}
+
+const vector<Facility>& Plan::getUnderConstruction() const
+{
+    return underConstruction;
+}
+
+const vector<long long>& Plan::getSkippedOperational() const
+{
+    return skippedOperational;
+}
+
+// The status recorded at the end of the last step (getStatus recomputes it)
+const PlanStatus Plan::getLastStatus() const
+{
+    return status;
+}
+
+// The restore* methods rebuild a plan from a checkpoint without re-adding scores
+void Plan::restoreState(PlanStatus status, long long lifeQualityScore, long long economyScore, long long environmentScore)
+{
+    this->status = status;
+    life_quality_score = lifeQualityScore;
+    economy_score = economyScore;
+    environment_score = environmentScore;
+}
+
+void Plan::restoreFacility(int typeId, FacilityStatus status, int completionTick)
+{
+    Facility facility(typeId, completionTick);
+    if (status == FacilityStatus::OPERATIONAL)
     {
-        std::cout << "FacilityName: "<< facility->getName()<< std::endl;
-        std::cout << "FacilityStatus: "<< facility->statusToString() << std::endl;
+        appendRun(typeId, 1);
     }
-    for (Facility *facility : underConstruction)
+    else
     {
-        std::cout << "FacilityName: "<< facility->getName()<< std::endl;
-        std::cout << "FacilityStatus: "<< facility->statusToString() << std::endl;
+        underConstruction.push_back(facility);
     }
 }
 
-const vector<Facility*>& Plan::getFacilities() const
+void Plan::restoreRun(int typeId, int count)
 {
-    return facilities;
+    appendRun(typeId, count);
+}
+
+void Plan::appendRun(int typeId, int count)
+{
+    if (!operationalRuns.empty() && operationalRuns.back().typeId == typeId)
+    {
+        operationalRuns.back().count += count;
+    }
+    else
+    {
+        operationalRuns.push_back({typeId, count});
+    }
+}
+
+void Plan::restoreSkipped(int typeId, long long count)
+{
+    if ((int)skippedOperational.size() <= typeId)
+    {
+        skippedOperational.resize(typeId + 1, 0);
+    }
+    skippedOperational[typeId] = count;
 }
\ No newline at end of file
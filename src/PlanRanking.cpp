@@ -0,0 +1,174 @@
+#include "../include/PlanRanking.h"
+#include <algorithm>
+#include <queue>
+
+PlanRanking::PlanRanking() {
+    invalidate();
+}
+
+void PlanRanking::markChanged(int planId) {
+    for (Heap &heap : heaps) {
+        if (!heap.valid) {
+            continue;
+        }
+        if (planId >= (int)heap.isChanged.size()) {
+            heap.isChanged.resize(planId + 1, 0);
+        }
+        if (!heap.isChanged[planId]) {
+            heap.isChanged[planId] = 1;
+            heap.changed.push_back(planId);
+        }
+    }
+}
+
+void PlanRanking::invalidate() {
+    for (Heap &heap : heaps) {
+        heap.valid = false;
+        heap.changed.clear();
+        heap.isChanged.clear();
+    }
+}
+
+bool PlanRanking::parseMetric(std::string_view name, RankMetric &metric) {
+    for (int i = 0; i < NUM_RANK_METRICS; i++) {
+        if (name == metricName((RankMetric)i)) {
+            metric = (RankMetric)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *PlanRanking::metricName(RankMetric metric) {
+    static const char *const NAMES[NUM_RANK_METRICS] = {"life", "economy", "environment", "spread"};
+    return NAMES[(int)metric];
+}
+
+long long PlanRanking::value(const Plan &plan, RankMetric metric) {
+    long long lifeQuality = plan.getlifeQualityScore(), economy = plan.getEconomyScore(), environment = plan.getEnvironmentScore();
+    switch (metric) {
+        case RankMetric::LIFE_QUALITY:
+            return lifeQuality;
+        case RankMetric::ECONOMY:
+            return economy;
+        case RankMetric::ENVIRONMENT:
+            return environment;
+        default:
+            return std::max({lifeQuality, economy, environment}) - std::min({lifeQuality, economy, environment});
+    }
+}
+
+static int64_t rankKey(const Plan &plan, RankMetric metric) {
+    int64_t value = PlanRanking::value(plan, metric);
+    return metric == RankMetric::SPREAD ? -value : value;
+}
+
+bool PlanRanking::better(const Heap &heap, int planA, int planB) {
+    int64_t keyA = heap.keys[planA], keyB = heap.keys[planB];
+    return keyA > keyB || (keyA == keyB && planA < planB);
+}
+
+void PlanRanking::place(Heap &heap, int position, int planId) {
+    heap.planIds[position] = planId;
+    heap.positions[planId] = position;
+}
+
+void PlanRanking::siftUp(Heap &heap, int position) {
+    int planId = heap.planIds[position];
+    while (position > 0) {
+        int parent = (position - 1) / 2;
+        if (!better(heap, planId, heap.planIds[parent])) {
+            break;
+        }
+        place(heap, position, heap.planIds[parent]);
+        position = parent;
+    }
+    place(heap, position, planId);
+}
+
+void PlanRanking::siftDown(Heap &heap, int position) {
+    int size = heap.planIds.size();
+    int planId = heap.planIds[position];
+    while (true) {
+        int child = 2 * position + 1;
+        if (child >= size) {
+            break;
+        }
+        if (child + 1 < size && better(heap, heap.planIds[child + 1], heap.planIds[child])) {
+            child++;
+        }
+        if (!better(heap, heap.planIds[child], planId)) {
+            break;
+        }
+        place(heap, position, heap.planIds[child]);
+        position = child;
+    }
+    place(heap, position, planId);
+}
+
+void PlanRanking::rebuild(Heap &heap, RankMetric metric, const PlanStore &plans) {
+    int numPlans = plans.size();
+    heap.planIds.resize(numPlans);
+    heap.positions.resize(numPlans);
+    heap.keys.resize(numPlans);
+    for (int i = 0; i < numPlans; i++) {
+        heap.keys[i] = rankKey(plans[i], metric);
+        place(heap, i, i);
+    }
+    for (int i = numPlans / 2 - 1; i >= 0; i--) {
+        siftDown(heap, i);
+    }
+    heap.changed.clear();
+    heap.isChanged.assign(numPlans, 0);
+    heap.valid = true;
+}
+
+// Plan ids are dense, so the ids past the heap's end are the plans added since
+void PlanRanking::refresh(Heap &heap, RankMetric metric, const PlanStore &plans) {
+    if (!heap.valid || heap.changed.size() > (size_t)plans.size() / 2) {
+        rebuild(heap, metric, plans);
+        return;
+    }
+    int size = heap.planIds.size();
+    heap.planIds.resize(plans.size());
+    heap.positions.resize(plans.size());
+    heap.keys.resize(plans.size());
+    for (int planId : heap.changed) {
+        if (planId < size) {
+            heap.keys[planId] = rankKey(plans[planId], metric);
+            siftUp(heap, heap.positions[planId]);
+            siftDown(heap, heap.positions[planId]);
+        }
+        heap.isChanged[planId] = 0;
+    }
+    heap.changed.clear();
+    for (int planId = size; planId < plans.size(); planId++) {
+        heap.keys[planId] = rankKey(plans[planId], metric);
+        place(heap, planId, planId);
+        siftUp(heap, planId);
+    }
+}
+
+// The k best plans by metric, best first
+void PlanRanking::top(int k, RankMetric metric, const PlanStore &plans, vector<int> &planIds) {
+    Heap &heap = heaps[(int)metric];
+    refresh(heap, metric, plans);
+    planIds.clear();
+    int size = heap.planIds.size();
+    // The next best plan is always a child of one already taken, so only the frontier is kept
+    auto worse = [&heap](int positionA, int positionB) {
+        return better(heap, heap.planIds[positionB], heap.planIds[positionA]);
+    };
+    std::priority_queue<int, vector<int>, decltype(worse)> frontier(worse);
+    if (size > 0) {
+        frontier.push(0);
+    }
+    while ((int)planIds.size() < k && !frontier.empty()) {
+        int position = frontier.top();
+        frontier.pop();
+        planIds.push_back(heap.planIds[position]);
+        for (int child = 2 * position + 1; child <= 2 * position + 2 && child < size; child++) {
+            frontier.push(child);
+        }
+    }
+}
@@ -0,0 +1,46 @@
+#include "../include/PlanStore.h"
+
+PlanStore::PlanStore() : numPlans(0) {
+}
+
+int PlanStore::size() const {
+    return numPlans;
+}
+
+bool PlanStore::empty() const {
+    return numPlans == 0;
+}
+
+void PlanStore::reserve(int numPlans) {
+    chunks.reserve((numPlans + CHUNK_SIZE - 1) >> CHUNK_BITS);
+}
+
+void PlanStore::add(Plan plan) {
+    if ((numPlans & CHUNK_MASK) == 0) {
+        chunks.push_back(std::make_shared<Chunk>());
+    }
+    writableChunk(numPlans >> CHUNK_BITS).plans[numPlans & CHUNK_MASK] = std::make_shared<Plan>(std::move(plan));
+    numPlans++;
+}
+
+PlanStore::Chunk &PlanStore::writableChunk(int chunkIndex) {
+    std::shared_ptr<Chunk> &chunk = chunks[chunkIndex];
+    if (chunk.use_count() > 1) {
+        chunk = std::make_shared<Chunk>(*chunk);
+    }
+    return *chunk;
+}
+
+Plan &PlanStore::writable(int index) {
+    std::shared_ptr<Plan> &plan = writableChunk(index >> CHUNK_BITS).plans[index & CHUNK_MASK];
+    if (plan.use_count() > 1) {
+        plan = std::make_shared<Plan>(*plan);
+    }
+    return *plan;
+}
+
+void PlanStore::unshareChunks() {
+    for (int i = 0; i < (int)chunks.size(); i++) {
+        writableChunk(i);
+    }
+}
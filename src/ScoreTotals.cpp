@@ -0,0 +1,70 @@
+#include "../include/ScoreTotals.h"
+
+static const ScoreTotal NO_PLANS = {0, 0, 0, 0};
+
+ScoreTotals::ScoreTotals() {
+    clear();
+}
+
+ScoreTotal &ScoreTotals::settlementTotal(int settlementHandle) {
+    if (settlementHandle >= (int)bySettlement.size()) {
+        bySettlement.resize(settlementHandle + 1, NO_PLANS);
+    }
+    return bySettlement[settlementHandle];
+}
+
+ScoreTotal *ScoreTotals::typeTotal(SettlementType type) {
+    if ((int)type < 0 || (int)type > 2) {
+        return nullptr;
+    }
+    return &byType[(int)type];
+}
+
+void ScoreTotals::addPlan(int settlementHandle, SettlementType type) {
+    global.numPlans++;
+    if (ScoreTotal *total = typeTotal(type)) {
+        total->numPlans++;
+    }
+    settlementTotal(settlementHandle).numPlans++;
+}
+
+void ScoreTotals::addFacility(int settlementHandle, SettlementType type, const FacilityType &facility) {
+    addScores(settlementHandle, type, facility.getLifeQualityScore(), facility.getEconomyScore(), facility.getEnvironmentScore());
+}
+
+void ScoreTotals::addScores(int settlementHandle, SettlementType type, long long lifeQualityScore, long long economyScore, long long environmentScore) {
+    for (ScoreTotal *total : {&global, typeTotal(type), &settlementTotal(settlementHandle)}) {
+        if (total == nullptr) {
+            continue;
+        }
+        total->lifeQualityScore += lifeQualityScore;
+        total->economyScore += economyScore;
+        total->environmentScore += environmentScore;
+    }
+}
+
+void ScoreTotals::clear() {
+    global = NO_PLANS;
+    for (ScoreTotal &total : byType) {
+        total = NO_PLANS;
+    }
+    bySettlement.clear();
+}
+
+const ScoreTotal &ScoreTotals::getGlobal() const {
+    return global;
+}
+
+const ScoreTotal &ScoreTotals::getByType(SettlementType type) const {
+    if ((int)type < 0 || (int)type > 2) {
+        return NO_PLANS;
+    }
+    return byType[(int)type];
+}
+
+ScoreTotal ScoreTotals::getBySettlement(int settlementHandle) const {
+    if (settlementHandle < 0 || settlementHandle >= (int)bySettlement.size()) {
+        return NO_PLANS;
+    }
+    return bySettlement[settlementHandle];
+}
@@ -0,0 +1,56 @@
+#include "../include/SelectionBatch.h"
+#include "../include/SelectionPolicy.h"
+#include <algorithm>
+
+/*
+Fills choices[i] with the catalog index plan i will build this tick, or -1 when the plan is
+busy or its policy selects on its own, and groups the available plans by policy kind. The
+round-robin policies are left to Plan::stepWith: with the catalog's category lists their
+selection is already O(1), and their state lives in the policy.
+*/
+void SelectionBatch::select(const PlanStore &plans, const FacilityCatalog &catalog, vector<int> &choices) {
+    choices.assign(plans.size(), -1);
+    for (vector<int> &group : groups) {
+        group.clear();
+    }
+    balancedRequests.clear();
+    for (int i = 0; i < plans.size(); i++) {
+        if (plans[i].getStatus() != PlanStatus::AVALIABLE) {
+            continue;
+        }
+        const PlanPolicy &policy = plans[i].getSelectionPolicy();
+        groups[(int)policy.getKind()].push_back(i);
+        if (const BalancedSelection *balanced = policy.getIf<BalancedSelection>()) {
+            balancedRequests.push_back(BalancedRequest{balanced->getLifeQualityScore(), balanced->getEconomyScore(), balanced->getEnvironmentScore(), i});
+        }
+    }
+    if (catalog.empty()) {
+        return;
+    }
+
+    // Sorting by target scores makes every group a contiguous run
+    std::sort(balancedRequests.begin(), balancedRequests.end(), [](const BalancedRequest &a, const BalancedRequest &b) {
+        if (a.lifeQualityScore != b.lifeQualityScore) {
+            return a.lifeQualityScore < b.lifeQualityScore;
+        }
+        if (a.economyScore != b.economyScore) {
+            return a.economyScore < b.economyScore;
+        }
+        return a.environmentScore < b.environmentScore;
+    });
+    for (size_t begin = 0; begin < balancedRequests.size();) {
+        const BalancedRequest &group = balancedRequests[begin];
+        int index = catalog.mostBalanced(group.lifeQualityScore, group.economyScore, group.environmentScore);
+        size_t end = begin;
+        while (end < balancedRequests.size() && balancedRequests[end].lifeQualityScore == group.lifeQualityScore
+               && balancedRequests[end].economyScore == group.economyScore && balancedRequests[end].environmentScore == group.environmentScore) {
+            choices[balancedRequests[end].planIndex] = index;
+            end++;
+        }
+        begin = end;
+    }
+}
+
+const vector<int> &SelectionBatch::getGroup(PolicyKind kind) const {
+    return groups[(int)kind];
+}
@@ -1,167 +1,257 @@
 #include "../include/SelectionPolicy.h"
 #include "../include/Facility.h"
-#include <limits>
-#include <algorithm>
-#include <iostream>
+#include "../include/FacilityCatalog.h"
 #include <stdexcept>
 using std::vector;
 using std::string;
 
+// Policies whose selections only depend on a small internal state report it here so a plan
+// can detect when it starts repeating itself; -1 means the state is unknown.
+int SelectionPolicy::getCycleState() const
+{
+    return -1;
+}
+
+// Out of line, so the inlined selectFacility bodies stay small. Plans may be stepped on worker
+// threads of any simulation in the process, so the message is left to whoever catches it
+void selectionFailed(const char *message)
+{
+    throw std::runtime_error(message);
+}
+
 // NaiveSelection class implementation
 
-NaiveSelection::NaiveSelection() : lastSelectedIndex(0) 
+NaiveSelection::NaiveSelection() : lastSelectedIndex(0)
 {
 }
 
-const FacilityType& NaiveSelection::selectFacility(const vector<FacilityType>& facilitiesOptions) {
-    std::cout << "NaiveSelection::selectFacility called" << std::endl;
-    if (facilitiesOptions.empty()) {
-        std::cerr << "Error: No facilities available for selection" << std::endl;
-        throw std::runtime_error("No facilities available for selection");
-    }
-    if (lastSelectedIndex >= facilitiesOptions.size()) {
-        std::cerr << "Error: lastSelectedIndex out of bounds" << std::endl;
-        throw std::runtime_error("lastSelectedIndex out of bounds");
-    }
-    std::cout << "Selecting facility at index: " << lastSelectedIndex << std::endl;
-    const FacilityType& selectedFacility = facilitiesOptions[lastSelectedIndex];
-    std::cout << "Selected facility: " << selectedFacility.getName() << std::endl;
-    lastSelectedIndex = (lastSelectedIndex + 1) % facilitiesOptions.size();
-    return selectedFacility;
+NaiveSelection::NaiveSelection(int lastSelectedIndex) : lastSelectedIndex(lastSelectedIndex)
+{
 }
 
-const string NaiveSelection::toString() const 
+const string NaiveSelection::toString() const
 {
-    return "nve"; 
+    return "nve";
 }
 
-SelectionPolicy* NaiveSelection::clone() const 
+int NaiveSelection::getCycleState() const
 {
-    return new NaiveSelection(*this);
+    return lastSelectedIndex;
 }
 
 // BalancedSelection class implementation
 
-BalancedSelection::BalancedSelection(int LifeQualityScore, int EconomyScore, int EnvironmentScore) 
-    : LifeQualityScore(LifeQualityScore), EconomyScore(EconomyScore), EnvironmentScore(EnvironmentScore) 
+BalancedSelection::BalancedSelection(int LifeQualityScore, int EconomyScore, int EnvironmentScore)
+    : LifeQualityScore(LifeQualityScore), EconomyScore(EconomyScore), EnvironmentScore(EnvironmentScore)
 {
 }
 
-const FacilityType& BalancedSelection::selectFacility(const vector<FacilityType>& facilitiesOptions) 
+int BalancedSelection::getLifeQualityScore() const
 {
-    FacilityType* selectedFacility = nullptr;
-    int minDifference = std::numeric_limits<int>::max();
+    return LifeQualityScore;
+}
 
-    for (const FacilityType& facility : facilitiesOptions) 
-    {
-        int lifeQualityScore = facility.getLifeQualityScore() + LifeQualityScore;
-        int economyScore = facility.getEconomyScore() + EconomyScore;
-        int environmentScore = facility.getEnvironmentScore() + EnvironmentScore;
+int BalancedSelection::getEconomyScore() const
+{
+    return EconomyScore;
+}
 
-        int scores[] = {lifeQualityScore, economyScore, environmentScore};
-        int maxScore = *std::max_element(std::begin(scores), std::end(scores));
-        int minScore = *std::min_element(std::begin(scores), std::end(scores));
-        int difference = maxScore - minScore;
+int BalancedSelection::getEnvironmentScore() const
+{
+    return EnvironmentScore;
+}
 
-        if (difference < minDifference) 
-        {
-            minDifference = difference;
-            selectedFacility = const_cast<FacilityType*>(&facility);
-        }
-    }
+const string BalancedSelection::toString() const
+{
+    return "bal";
+}
 
-    if (selectedFacility == nullptr) 
-    {
-        throw std::runtime_error("No facility found.");
-    }
+// The target scores are fixed, so every selection is the same
+int BalancedSelection::getCycleState() const
+{
+    return 0;
+}
+
+// EconomySelection class implementation
 
-    return *selectedFacility;
+EconomySelection::EconomySelection() : lastSelectedIndex(0), categoryCursor(-1)
+{
 }
 
-const string BalancedSelection::toString() const 
+EconomySelection::EconomySelection(int lastSelectedIndex) : lastSelectedIndex(lastSelectedIndex), categoryCursor(-1)
 {
-    return "bal"; 
 }
 
-SelectionPolicy* BalancedSelection::clone() const 
+const string EconomySelection::toString() const
 {
-    return new BalancedSelection(*this);
+    return "eco";
 }
 
-// EconomySelection class implementation
+int EconomySelection::getCycleState() const
+{
+    return lastSelectedIndex;
+}
+
+// SustainabilitySelection class implementation
+
+SustainabilitySelection::SustainabilitySelection() : lastSelectedIndex(0), categoryCursor(-1)
+{
+}
 
-EconomySelection::EconomySelection() : lastSelectedIndex(0) 
+SustainabilitySelection::SustainabilitySelection(int lastSelectedIndex) : lastSelectedIndex(lastSelectedIndex), categoryCursor(-1)
 {
 }
 
-const FacilityType& EconomySelection::selectFacility(const vector<FacilityType>& facilitiesOptions) 
+const string SustainabilitySelection::toString() const
 {
-    const FacilityType* selectedFacility = nullptr;
+    return "env";
+}
+
+int SustainabilitySelection::getCycleState() const
+{
+    return lastSelectedIndex;
+}
+
+// CustomSelection class implementation
+
+CustomSelection::CustomSelection(SelectionPolicy *policy) : policy(policy)
+{
+}
+
+CustomSelection::CustomSelection(const CustomSelection &other) : policy(other.policy->clone())
+{
+}
 
-    for (int i = lastSelectedIndex; i < lastSelectedIndex + facilitiesOptions.size(); i++) 
+CustomSelection::CustomSelection(CustomSelection &&other) noexcept : policy(other.policy)
+{
+    other.policy = nullptr;
+}
+
+CustomSelection &CustomSelection::operator=(const CustomSelection &other)
+{
+    if (this != &other)
     {
-        int index = i % facilitiesOptions.size();
-        if (facilitiesOptions[index].getCategory() == FacilityCategory::ECONOMY) 
-        {
-            selectedFacility = &facilitiesOptions[index];
-            lastSelectedIndex = (index + 1) % facilitiesOptions.size();
-            break;
-        }
+        delete policy;
+        policy = other.policy->clone();
     }
+    return *this;
+}
 
-    if (selectedFacility == nullptr) 
+CustomSelection &CustomSelection::operator=(CustomSelection &&other) noexcept
+{
+    if (this != &other)
     {
-        throw std::runtime_error("No facility in the ECONOMY category found.");
+        delete policy;
+        policy = other.policy;
+        other.policy = nullptr;
     }
+    return *this;
+}
 
-    return *selectedFacility;
+CustomSelection::~CustomSelection()
+{
+    delete policy;
 }
 
-const string EconomySelection::toString() const 
+const FacilityType& CustomSelection::selectFacility(const FacilityCatalog& facilitiesOptions)
 {
-    return "eco"; 
+    return policy->selectFacility(facilitiesOptions);
 }
 
-SelectionPolicy* EconomySelection::clone() const 
+const string CustomSelection::toString() const
 {
-    return new EconomySelection(*this);
+    return policy->toString();
 }
 
-// SustainabilitySelection class implementation
+int CustomSelection::getCycleState() const
+{
+    return policy->getCycleState();
+}
+
+// PlanPolicy class implementation
+
+PlanPolicy::PlanPolicy()
+{
+}
 
-SustainabilitySelection::SustainabilitySelection() : lastSelectedIndex(0) 
+PlanPolicy::PlanPolicy(const NaiveSelection &policy) : policy(policy)
 {
 }
 
-const FacilityType& SustainabilitySelection::selectFacility(const vector<FacilityType>& facilitiesOptions) 
+PlanPolicy::PlanPolicy(const BalancedSelection &policy) : policy(policy)
 {
-    const FacilityType* selectedFacility = nullptr;
+}
 
-    for (int i = lastSelectedIndex; i < lastSelectedIndex + facilitiesOptions.size(); i++) 
+PlanPolicy::PlanPolicy(const EconomySelection &policy) : policy(policy)
+{
+}
+
+PlanPolicy::PlanPolicy(const SustainabilitySelection &policy) : policy(policy)
+{
+}
+
+PlanPolicy::PlanPolicy(SelectionPolicy *policy)
+{
+    if (policy != nullptr)
     {
-        int index = i % facilitiesOptions.size();
-        if (facilitiesOptions[index].getCategory() == FacilityCategory::ENVIRONMENT) 
-        {
-            selectedFacility = &facilitiesOptions[index];
-            lastSelectedIndex = (index + 1) % facilitiesOptions.size();
-            break;
-        }
+        this->policy.emplace<CustomSelection>(policy);
     }
+}
+
+PolicyKind PlanPolicy::getKind() const
+{
+    return static_cast<PolicyKind>(policy.index());
+}
+
+bool PlanPolicy::isSet() const
+{
+    return policy.index() != 0;
+}
 
-    if (selectedFacility == nullptr) 
+// For callers that don't know the kind; the step loop dispatches once per group instead
+const FacilityType& PlanPolicy::selectFacility(const FacilityCatalog& facilitiesOptions)
+{
+    switch (getKind())
     {
-        throw std::runtime_error("No facility in the ENVIRONMENT category found.");
+        case PolicyKind::NAIVE:
+            return get<NaiveSelection>().selectFacility(facilitiesOptions);
+        case PolicyKind::BALANCED:
+            return get<BalancedSelection>().selectFacility(facilitiesOptions);
+        case PolicyKind::ECONOMY:
+            return get<EconomySelection>().selectFacility(facilitiesOptions);
+        case PolicyKind::SUSTAINABILITY:
+            return get<SustainabilitySelection>().selectFacility(facilitiesOptions);
+        case PolicyKind::CUSTOM:
+            return get<CustomSelection>().selectFacility(facilitiesOptions);
+        default:
+            selectionFailed("No selection policy");
     }
-
-    return *selectedFacility;
 }
 
-const string SustainabilitySelection::toString() const 
+const string PlanPolicy::toString() const
 {
-    return "env"; 
+    return std::visit([](const auto &policy) -> string {
+        if constexpr (std::is_same_v<std::decay_t<decltype(policy)>, std::monostate>)
+        {
+            return "";
+        }
+        else
+        {
+            return policy.toString();
+        }
+    }, policy);
 }
 
-SelectionPolicy* SustainabilitySelection::clone() const 
+int PlanPolicy::getCycleState() const
 {
-    return new SustainabilitySelection(*this);
-}
\ No newline at end of file
+    return std::visit([](const auto &policy) {
+        if constexpr (std::is_same_v<std::decay_t<decltype(policy)>, std::monostate>)
+        {
+            return -1;
+        }
+        else
+        {
+            return policy.getCycleState();
+        }
+    }, policy);
+}
@@ -0,0 +1,86 @@
+#include "../include/SettlementIndex.h"
+#include "../include/Settlement.h"
+#include <functional>
+
+static const int INITIAL_CAPACITY = 16; //Must be a power of two
+
+SettlementIndex::SettlementIndex() : slots(INITIAL_CAPACITY, Slot{0, -1}), count(0) {}
+
+// Returns the handle of the settlement with the given name, or -1 if there is none
+int SettlementIndex::find(std::string_view name, const vector<Settlement*> &settlements) const {
+    size_t hash = std::hash<std::string_view>()(name); //Same value as std::hash<string> of the name
+    size_t mask = slots.size() - 1;
+    for (size_t i = hash & mask; slots[i].handle != -1; i = (i + 1) & mask) {
+        if (slots[i].hash == hash && settlements[slots[i].handle]->getName() == name) {
+            return slots[i].handle;
+        }
+    }
+    return -1;
+}
+
+// The caller makes sure the name is not indexed yet
+void SettlementIndex::insert(int handle, const vector<Settlement*> &settlements) {
+    // Keep the load factor under 1/2 so probe sequences stay short
+    if (2 * (count + 1) > (int)slots.size()) {
+        grow();
+    }
+    size_t hash = std::hash<string>()(settlements[handle]->getName());
+    size_t mask = slots.size() - 1;
+    size_t i = hash & mask;
+    while (slots[i].handle != -1) {
+        i = (i + 1) & mask;
+    }
+    slots[i] = Slot{hash, handle};
+    count++;
+}
+
+// Removes the entry for settlements[handle]; the following slots of the probe run are shifted
+// back so no tombstones are needed
+void SettlementIndex::erase(int handle, const vector<Settlement*> &settlements) {
+    size_t mask = slots.size() - 1;
+    size_t i = std::hash<string>()(settlements[handle]->getName()) & mask;
+    while (slots[i].handle != handle) {
+        if (slots[i].handle == -1) {
+            return;
+        }
+        i = (i + 1) & mask;
+    }
+    slots[i].handle = -1;
+    count--;
+    for (size_t j = (i + 1) & mask; slots[j].handle != -1; j = (j + 1) & mask) {
+        size_t home = slots[j].hash & mask;
+        // The entry at j may stay if its home slot lies cyclically in (i, j]
+        bool reachable = i <= j ? (i < home && home <= j) : (i < home || home <= j);
+        if (reachable) {
+            continue;
+        }
+        slots[i] = slots[j];
+        slots[j].handle = -1;
+        i = j;
+    }
+}
+
+void SettlementIndex::rebuild(const vector<Settlement*> &settlements) {
+    slots.assign(INITIAL_CAPACITY, Slot{0, -1});
+    count = 0;
+    for (int handle = 0; handle < (int)settlements.size(); handle++) {
+        insert(handle, settlements);
+    }
+}
+
+void SettlementIndex::grow() {
+    vector<Slot> old;
+    old.swap(slots);
+    slots.assign(old.size() * 2, Slot{0, -1});
+    size_t mask = slots.size() - 1;
+    for (const Slot &slot : old) {
+        if (slot.handle == -1) {
+            continue;
+        }
+        size_t i = slot.hash & mask;
+        while (slots[i].handle != -1) {
+            i = (i + 1) & mask;
+        }
+        slots[i] = slot;
+    }
+}
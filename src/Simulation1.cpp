@@ -2,61 +2,106 @@
 #include <vector>
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <cstring>
+#include <string_view>
 #include "../include/Simulation.h"
 #include "../include/Settlement.h"
 #include "../include/Auxiliary.h"
 #include "../include/Action.h"
+#include "../include/ThreadPool.h"
+#include "../include/ConstructionScheduler.h"
+#include "../include/SelectionBatch.h"
+#include "../include/MappedFile.h"
+#include "../include/LineReader.h"
+#include "../include/WriteAheadLog.h"
+#include "../include/Log.h"
+#include "../include/Stats.h"
+#include "../include/Trace.h"
 using std::string;
 using std::vector;
 
-Simulation* Simulation::backup = nullptr;
+static const int MAX_ARGUMENTS = 8; //For config lines and commands, the longest (facility) has 7
 
-Simulation::Simulation(const string &configFilePath): isRunning(true), planCounter(0){
-    std::ifstream configFile(configFilePath);
-    if (!configFile.is_open()) {
+// An empty world, filled in by loadCheckpoint
+Simulation::Simulation(): isRunning(true), planCounter(0), currentTick(0), scheduler(new ConstructionScheduler()), plans(new PlanStore()), scoreTotals(new ScoreTotals()), backup(nullptr), threadPool(nullptr), writeAheadLog(nullptr), compactHistory(false), output(&std::cout){
+}
+
+Simulation::Simulation(const string &configFilePath): isRunning(true), planCounter(0), currentTick(0), scheduler(new ConstructionScheduler()), plans(new PlanStore()), scoreTotals(new ScoreTotals()), backup(nullptr), threadPool(nullptr), writeAheadLog(nullptr), compactHistory(false), output(&std::cout){
+    STATS_TIMER(Phase::CONFIG_LOAD);
+    MappedFile configFile;
+    if (!configFile.open(configFilePath)) {
         std::cerr << "Error opening configuration file: " << configFilePath << std::endl;
         return;
     }
 
-    string line;
-    while (std::getline(configFile, line)) {
+    // Lines are tokenized in place in the mapped file; only the names that are kept get copied
+    const char *position = configFile.data();
+    const char *fileEnd = position + configFile.size();
+    std::string_view args[MAX_ARGUMENTS];
+    while (position < fileEnd) {
+        const char *lineEnd = static_cast<const char*>(std::memchr(position, '\n', fileEnd - position));
+        if (lineEnd == nullptr) {
+            lineEnd = fileEnd;
+        }
+        std::string_view line(position, lineEnd - position);
+        position = lineEnd + 1;
         if (line.empty() || line[0] == '#') continue; // Skip comments and empty lines
-        auto args = Auxiliary::parseArguments(line);
-        if (args[0] == "settlement") {
+        int numArgs = Auxiliary::tokenize(line, args, MAX_ARGUMENTS);
+        if (numArgs == 0) continue;
+        int type, price, lifeQuality, economy, environment;
+        if (args[0] == "settlement" && numArgs >= 3 && Auxiliary::parseInt(args[2], type)) {
             // Add settlement
-            SettlementType type = static_cast<SettlementType>(std::stoi(args[2]));
-            addSettlement(new Settlement(args[1], type));
-        } else if (args[0] == "facility") {
-            // Add facility type
-            FacilityCategory category = static_cast<FacilityCategory>(std::stoi(args[2]));
-            facilitiesOptions.emplace_back(args[1], category, std::stoi(args[3]), std::stoi(args[4]), std::stoi(args[5]), std::stoi(args[6]));
-        } else if (args[0] == "plan") {
+            if (type < (int)SettlementType::VILLAGE || type > (int)SettlementType::METROPOLIS) {
+                std::cerr << "Skipping invalid settlement: " << line << std::endl;
+                continue;
+            }
+            addSettlement(new Settlement(string(args[1]), static_cast<SettlementType>(type)));
+        } else if (args[0] == "facility" && numArgs >= 7 && Auxiliary::parseInt(args[2], type) && Auxiliary::parseInt(args[3], price)
+                   && Auxiliary::parseInt(args[4], lifeQuality) && Auxiliary::parseInt(args[5], economy) && Auxiliary::parseInt(args[6], environment)) {
+            // Add facility type, checked like the facility command
+            if (!addFacility(FacilityType(string(args[1]), static_cast<FacilityCategory>(type), price, lifeQuality, economy, environment))) {
+                std::cerr << "Skipping invalid facility: " << line << std::endl;
+            }
+        } else if (args[0] == "plan" && numArgs >= 3) {
             // Add plan
-            SelectionPolicy *policy = nullptr;
+            int handle = settlementIndex.find(args[1], settlements);
+            if (handle == -1) {
+                *output << "Settlement does not exist" << '\n';
+                continue;
+            }
+            PlanPolicy policy;
             if (args[2] == "eco") {
-                policy = new EconomySelection();
+                policy = EconomySelection();
             } else if (args[2] == "bal") {
-                policy = new BalancedSelection(0, 0, 0);
+                policy = BalancedSelection(0, 0, 0);
             } else if (args[2] == "sus") {
-                policy = new SustainabilitySelection();
+                policy = SustainabilitySelection();
             } else if (args[2] == "nve") {
-                policy = new NaiveSelection();
+                policy = NaiveSelection();
             }
             else{
-                std::cout << "Unknown selection policy" << std::endl;
+                *output << "Unknown selection policy" << '\n';
             }
-            addPlan(getSettlement(args[1]), policy);
+            addPlan(*settlements[handle], policy);
+        } else {
+            std::cerr << "Skipping invalid configuration line: " << line << std::endl;
         }
     }
-    configFile.close();
 }
 
 Simulation::~Simulation() {
     for (auto settlement :settlements){
         delete settlement;
     }
-    for (auto action : actionsLog){
-        delete action;
+    if (threadPool != nullptr){
+        delete threadPool;
+    }
+    if (writeAheadLog != nullptr){
+        delete writeAheadLog;
+    }
+    if (backup != nullptr){
+        delete backup;
     }
     
     /* 
@@ -73,28 +118,35 @@ Simulation::~Simulation() {
     */ 
 }
 
-Simulation::Simulation(const Simulation &other): isRunning(other.isRunning), planCounter(other.planCounter){
+// The scheduler and the score totals are shared copy-on-write with other; the plans are copied
+// (see copyPlans)
+Simulation::Simulation(const Simulation &other): isRunning(other.isRunning), planCounter(other.planCounter), currentTick(other.currentTick), scheduler(other.scheduler), actionsLog(other.actionsLog), planSettlements(other.planSettlements), scoreTotals(other.scoreTotals), backup(nullptr), threadPool(nullptr), writeAheadLog(nullptr), compactHistory(other.compactHistory), output(other.output){
     for (auto settlement : other.settlements){
         settlements.push_back(new Settlement(*settlement));
     }
-    for (auto action : other.actionsLog){
-        actionsLog.push_back(action->clone());
-    }
-    for (auto facility : other.facilitiesOptions){
-        facilitiesOptions.push_back(facility);
-    }
-    for (auto plan : other.plans){
-        plans.push_back(plan);
+    settlementIndex.rebuild(settlements);
+    facilitiesOptions = other.facilitiesOptions;
+    copyPlans(*other.plans);
+}
+
+// A plan points at its settlement and at the facility options, which belong to the simulation,
+// so a copied simulation gets its own plans pointing at its own
+void Simulation::copyPlans(const PlanStore &otherPlans){
+    plans = std::make_shared<PlanStore>();
+    plans->reserve(otherPlans.size());
+    for (int i = 0; i < otherPlans.size(); i++){
+        Plan plan(otherPlans[i]);
+        plan.rebind(*settlements[settlementIndex.find(plan.getSettlement().getName(), settlements)], facilitiesOptions);
+        plans->add(std::move(plan));
     }
 }
 
 Settlement &Simulation::getSettlement(const string &settlementName){
-    for (auto settlement : settlements){
-        if (settlement->getName() == settlementName){
-            return *settlement;
-        }
+    int handle = settlementIndex.find(settlementName, settlements);
+    if (handle != -1){
+        return *settlements[handle];
     }
-    std::cout << "Settlement does not exist" << std::endl;
+    *output << "Settlement does not exist" << '\n';
     throw std::runtime_error("Settlement does not exist");
 }
 
@@ -105,43 +157,172 @@ Simulation &Simulation::operator=(const Simulation &other){
     for (auto settlement : settlements){
         delete settlement;
     }
-    for (auto action : actionsLog){
-        delete action;
-    }
     settlements.clear();
-    actionsLog.clear();
     facilitiesOptions.clear();
-    plans.clear();
     isRunning = other.isRunning;
     planCounter = other.planCounter;
+    currentTick = other.currentTick;
+    compactHistory = other.compactHistory;
+    scheduler = other.scheduler;
     for (auto settlement : other.settlements){
         settlements.push_back(new Settlement(*settlement));
     }
-    for (auto action : other.actionsLog){
-        actionsLog.push_back(action->clone());
-    }
-    for (auto facility : other.facilitiesOptions){
-        facilitiesOptions.push_back(facility);
-    }
-    for (auto plan : other.plans){
-        plans.push_back(plan);
-    }
+    settlementIndex.rebuild(settlements);
+    actionsLog = other.actionsLog;
+    facilitiesOptions = other.facilitiesOptions;
+    copyPlans(*other.plans);
+    planSettlements = other.planSettlements;
+    scoreTotals = other.scoreTotals;
+    planRanking.invalidate();
     return *this;
 }
 
-void Simulation::addPlan(const Settlement &settlement, SelectionPolicy *selectionPolicy){
-    std::cout << "Simulation::addPlan called with selectionPolicy: " << selectionPolicy << std::endl;
-    plans.emplace_back(planCounter, settlement, selectionPolicy, facilitiesOptions);
+void Simulation::addPlan(const Settlement &settlement, const PlanPolicy &selectionPolicy){
+    Plan plan(planCounter, settlement, selectionPolicy, facilitiesOptions);
+    plan.setCompactHistory(compactHistory);
+    writablePlans().add(std::move(plan));
+    // Ids past planCounter may be left over from before a restore
+    planSettlements.resize(planCounter + 1);
+    planSettlements[planCounter] = getSettlementHandle(settlement.getName());
+    writableScoreTotals().addPlan(planSettlements[planCounter], settlement.getType());
+    planRanking.markChanged(planCounter);
     planCounter++;
 }
 
+// Only the action's record is kept, the action itself is deleted
 void Simulation::addAction(BaseAction *action){
-    actionsLog.push_back(action);
+    ActionRecord record = action->toRecord(actionsLog);
+    actionsLog.append(record);
+    delete action;
+    if (writeAheadLog != nullptr){
+        writeAheadLog->append(record, actionsLog);
+        // A saved checkpoint makes everything journaled before it redundant, unless restore
+        // can still go back to an in-memory backup, which checkpoints don't hold
+        if (record.kind == ActionKind::BACKUP && record.args[0] != -1 && record.status == (uint8_t)ActionStatus::COMPLETED && backup == nullptr){
+            writeAheadLog->compact(actionsLog.getString(record.args[0]), actionsLog);
+        }
+    }
+}
+
+// Steps the available plans with a Policy, as grouped by the last SelectionBatch::select.
+// The task captures only [this, &group] so that std::function stores it without allocating.
+template <typename Policy>
+void Simulation::stepGroup(PolicyKind kind){
+    const vector<int> &group = selectionBatch.getGroup(kind);
+    auto stepPlans = [this, &group](int begin, int end){
+        for (int k = begin; k < end; k++){
+            int i = group[k];
+            stepCompletionTicks[i] = writablePlan(i).stepWith<Policy>(currentTick, stepChoices[i]); //stepChoices[i] becomes what was started
+        }
+    };
+    int numPlans = group.size();
+    if (threadPool == nullptr){
+        stepPlans(0, numPlans);
+    }
+    else{
+        // Plans only touch their own facilities and policy, so they are stepped concurrently
+        threadPool->parallelFor(numPlans, numPlans / (threadPool->getNumThreads() * 8), stepPlans);
+    }
 }
 
 void Simulation::step(){
-    for (auto &plan : plans){
-        plan.step();
+    STATS_TIMER(Phase::SIMULATION_STEP);
+    currentTick++;
+    TRACE_SCOPE("simulation_step", currentTick);
+    int numPlans = plans->size();
+    vector<int> &completionTicks = stepCompletionTicks;
+    vector<int> &choices = stepChoices;
+    completionTicks.assign(numPlans, -1);
+    {
+        STATS_TIMER(Phase::SELECT_BATCH);
+        TRACE_SCOPE("select_batch", currentTick);
+        selectionBatch.select(*plans, facilitiesOptions, choices);
+    }
+    // Only the plans that are about to build are stepped, and copied away from a backup; a
+    // busy plan's step does nothing. Each policy group runs a loop specialized for its type.
+    if (threadPool != nullptr){
+        writablePlans().unshareChunks();
+    }
+    stepGroup<NaiveSelection>(PolicyKind::NAIVE);
+    stepGroup<BalancedSelection>(PolicyKind::BALANCED);
+    stepGroup<EconomySelection>(PolicyKind::ECONOMY);
+    stepGroup<SustainabilitySelection>(PolicyKind::SUSTAINABILITY);
+    stepGroup<CustomSelection>(PolicyKind::CUSTOM);
+    for (int i : selectionBatch.getGroup(PolicyKind::NONE)){
+        writablePlan(i).step(currentTick, -1); //Reports the missing policy
+    }
+
+    ConstructionScheduler &pending = writableScheduler();
+    for (int i = 0; i < numPlans; i++){
+        if (completionTicks[i] != -1){
+            pending.schedule(completionTicks[i], i);
+        }
+    }
+    // Only plans with a facility finishing this tick are touched
+    vector<int> &duePlans = stepDuePlans;
+    duePlans.clear();
+    pending.popDue(currentTick, duePlans);
+    for (int planIndex : duePlans){
+        writablePlan(planIndex).completeFacilities(currentTick);
+    }
+    ScoreTotals &totals = writableScoreTotals();
+    for (int i = 0; i < numPlans; i++){
+        if (completionTicks[i] != -1){
+            Plan &plan = writablePlan(i);
+            plan.updateStatus();
+            totals.addFacility(planSettlements[i], plan.getSettlement().getType(), facilitiesOptions[choices[i]]);
+            planRanking.markChanged(i);
+        }
+    }
+}
+
+static const int FAST_FORWARD_MIN_STEPS = 1000;
+
+// Simulates numSteps ticks. Long horizons are fast-forwarded plan by plan (see Plan::fastForward)
+// only until each plan repeats itself; the resulting state is the same as stepping tick by tick.
+void Simulation::step(int numSteps){
+    if (numSteps < FAST_FORWARD_MIN_STEPS){
+        for (int i = 0; i < numSteps; i++){
+            step();
+        }
+        return;
+    }
+
+    STATS_TIMER(Phase::FAST_FORWARD);
+    TRACE_SCOPE("fast_forward", numSteps);
+    int targetTick = currentTick + numSteps;
+    writablePlans().unshareChunks();
+    auto fastForward = [this, targetTick](int begin, int end){
+        for (int i = begin; i < end; i++){
+            writablePlan(i).fastForward(currentTick, targetTick);
+        }
+    };
+    int numPlans = plans->size();
+    if (threadPool == nullptr){
+        fastForward(0, numPlans);
+    }
+    else{
+        threadPool->parallelFor(numPlans, 1, fastForward);
+    }
+
+    currentTick = targetTick;
+    scheduler = std::make_shared<ConstructionScheduler>();
+    for (int i = 0; i < numPlans; i++){
+        for (const Facility &facility : (*plans)[i].getUnderConstruction()){
+            scheduler->schedule(facility.getCompletionTick(), i);
+        }
+    }
+    rebuildScoreTotals();
+    planRanking.invalidate();
+}
+
+void Simulation::setNumThreads(int numThreads){
+    if (threadPool != nullptr){
+        delete threadPool;
+        threadPool = nullptr;
+    }
+    if (numThreads > 1){
+        threadPool = new ThreadPool(numThreads);
     }
 }
 
@@ -150,6 +331,7 @@ bool Simulation::addSettlement(Settlement *settlement){
         return false;
     }
     settlements.push_back(settlement);
+    settlementIndex.insert(settlements.size() - 1, settlements);
     return true;
 }
 
@@ -158,30 +340,60 @@ bool Simulation::addFacility(FacilityType facility){
         return false;
     }
 
-    if ((int)facility.getCategory() < 0 || (int)facility.getCategory() > 2){
-        return false;
-    }
-    facilitiesOptions.push_back(facility);
-    return true;
+    return facilitiesOptions.add(facility);
 }
 
 bool Simulation::isSettlementExists(const string &settlementName){
-    for (auto settlement : settlements){
-        if (settlement->getName() == settlementName){
-            return true;
-        }
+    return settlementIndex.find(settlementName, settlements) != -1;
+}
+
+// Plan ids are handed out from planCounter in order, so a plan's id is its index in plans.
+void Simulation::checkPlanId(int planID) const{
+    if (planID < 0 || planID >= (int)plans->size()){
+        *output << "Plan does not exist" << '\n';
+        throw std::runtime_error("Plan does not exist");
     }
-    return false;
 }
 
-Plan &Simulation::getPlan(const int planID){
-    for (auto &plan : plans){
-        if (plan.getPlanId() == planID){
-            return plan;
-        }
+// Reading a plan leaves a backup's plans shared
+const Plan &Simulation::getPlan(const int planID) const{
+    checkPlanId(planID);
+    return (*plans)[planID];
+}
+
+// The caller may modify the plan, so it is copied away from a backup first
+Plan &Simulation::getWritablePlan(const int planID){
+    checkPlanId(planID);
+    return writablePlan(planID);
+}
+
+int Simulation::getSettlementHandle(const string &settlementName) const{
+    return settlementIndex.find(settlementName, settlements);
+}
+
+const ScoreTotals &Simulation::getScoreTotals() const{
+    return *scoreTotals;
+}
+
+// The k best plans by metric, best first
+void Simulation::getTopPlans(int k, RankMetric metric, vector<const Plan*> &topPlans){
+    vector<int> planIds;
+    planRanking.top(k, metric, *plans, planIds);
+    topPlans.clear();
+    for (int planId : planIds){
+        topPlans.push_back(&(*plans)[planId]);
+    }
+}
+
+// From the plans' own scores, after they changed all at once (fast-forward, checkpoint load)
+void Simulation::rebuildScoreTotals(){
+    scoreTotals = std::make_shared<ScoreTotals>();
+    for (int i = 0; i < plans->size(); i++){
+        const Plan &plan = (*plans)[i];
+        SettlementType type = plan.getSettlement().getType();
+        scoreTotals->addPlan(planSettlements[i], type);
+        scoreTotals->addScores(planSettlements[i], type, plan.getlifeQualityScore(), plan.getEconomyScore(), plan.getEnvironmentScore());
     }
-    std::cout << "Plan does not exist" << std::endl;
-    throw std::runtime_error("Plan does not exist");
 }
 
 void Simulation::close(){
@@ -195,70 +407,252 @@ void Simulation::open(){
 
 void Simulation::start(){
     open();
-    std::cout << "The simulation has started." << std::endl;
+    *output << "The simulation has started." << '\n';
+    output->flush();
     string command;
     
-    while (isRunning) {
-        std::getline(std::cin, command);
-        auto args = Auxiliary::parseArguments(command);
-        if (args.empty()) {
-            continue;
+    while (isRunning && std::getline(std::cin, command)) {
+        if (!runCommand(command)) {
+            break;
         }
+        if (writeAheadLog != nullptr) {
+            writeAheadLog->commit(); //Durable before it is answered
+        }
+        output->flush(); //Someone is waiting for the answer
+        Log::flush();
+    }
+}
+
+// Batch mode: same commands as start(), output stays buffered until the caller flushes it
+void Simulation::start(LineReader &commands){
+    open();
+    *output << "The simulation has started." << '\n';
+    std::string_view command;
 
-        string requestedAction = args[0];
-        BaseAction *action = nullptr;
-
-        if (requestedAction == "settlement" && args.size() == 3) {
-            SettlementType type = static_cast<SettlementType>(std::stoi(args[2]));
-            action = new AddSettlement(args[1], type);
-        } else if (requestedAction == "facility" && args.size() == 7) {
-            FacilityCategory category = static_cast<FacilityCategory>(std::stoi(args[2]));
-            action = new AddFacility(args[1], category, std::stoi(args[3]), std::stoi(args[4]), std::stoi(args[5]), std::stoi(args[6]));
-        } else if (requestedAction == "plan" && args.size() == 3) {
-            action = new AddPlan(args[1], args[2]);
-        } else if (requestedAction == "planStatus" && args.size() == 2) {
-            action = new PrintPlanStatus(std::stoi(args[1]));
-        } else if (requestedAction == "changePolicy" && args.size() == 3) {
-            action = new ChangePlanPolicy(std::stoi(args[1]), args[2]);
-        } else if (requestedAction == "step" && args.size() == 2) {
-            action = new SimulateStep(std::stoi(args[1]));
-        } else if (requestedAction == "log" && args.size() == 1) {
-            action = new PrintActionsLog();
-        } else if (requestedAction == "close" && args.size() == 1) {
-            action = new Close();
-        } else if (requestedAction == "backup" && args.size() == 1) {
-            action = new BackupSimulation();
-        } else if (requestedAction == "restore" && args.size() == 1) {
-            action = new RestoreSimulation();
-        } else if (requestedAction == "exit" && args.size() == 1) {
+    while (isRunning && commands.next(command)) {
+        if (!runCommand(command)) {
             break;
+        }
+    }
+}
+
+// Parses and executes one command line, returns false for exit
+bool Simulation::runCommand(std::string_view command){
+    std::string_view args[MAX_ARGUMENTS];
+    int numArgs = Auxiliary::tokenize(command, args, MAX_ARGUMENTS);
+    if (numArgs == 0) {
+        return true;
+    }
+    TRACE_SCOPE_TEXT("command", command);
+
+    std::string_view requestedAction = args[0];
+    BaseAction *action = nullptr;
+    int type, price, lifeQuality, economy, environment, number, count;
+
+    if (requestedAction == "settlement" && numArgs == 3 && Auxiliary::parseInt(args[2], type)) {
+        action = new AddSettlement(string(args[1]), static_cast<SettlementType>(type));
+    } else if (requestedAction == "facility" && numArgs == 7 && Auxiliary::parseInt(args[2], type) && Auxiliary::parseInt(args[3], price)
+               && Auxiliary::parseInt(args[4], lifeQuality) && Auxiliary::parseInt(args[5], economy) && Auxiliary::parseInt(args[6], environment)) {
+        action = new AddFacility(string(args[1]), static_cast<FacilityCategory>(type), price, lifeQuality, economy, environment);
+    } else if (requestedAction == "plan" && numArgs == 3) {
+        action = new AddPlan(string(args[1]), string(args[2]));
+    } else if (requestedAction == "planStatus" && numArgs == 2 && Auxiliary::parseInt(args[1], number)) {
+        action = new PrintPlanStatus(number);
+    } else if (requestedAction == "aggregate" && numArgs == 1) {
+        action = new PrintAggregate();
+    } else if (requestedAction == "aggregate" && numArgs == 3 && args[1] == "settlement") {
+        action = new PrintAggregate(string(args[2]));
+    } else if (requestedAction == "aggregate" && numArgs == 3 && args[1] == "type" && Auxiliary::parseInt(args[2], type)) {
+        action = new PrintAggregate(static_cast<SettlementType>(type));
+    } else if (requestedAction == "top" && numArgs == 3 && Auxiliary::parseInt(args[1], number)) {
+        action = new PrintTopPlans(number, string(args[2]));
+    } else if (requestedAction == "changePolicy" && numArgs == 3 && Auxiliary::parseInt(args[1], number)) {
+        action = new ChangePlanPolicy(number, string(args[2]));
+    } else if (requestedAction == "step" && numArgs == 2 && Auxiliary::parseInt(args[1], number)) {
+        action = new SimulateStep(number);
+    } else if (requestedAction == "log" && numArgs == 1) {
+        action = new PrintActionsLog();
+    } else if (requestedAction == "log" && numArgs == 3 && Auxiliary::parseInt(args[1], number) && Auxiliary::parseInt(args[2], count)) {
+        action = new PrintActionsLog(number, count);
+    } else if (requestedAction == "close" && numArgs == 1) {
+        action = new Close();
+    } else if (requestedAction == "backup" && numArgs == 1) {
+        action = new BackupSimulation();
+    } else if (requestedAction == "backup" && numArgs == 2) {
+        action = new BackupSimulation(string(args[1]));
+    } else if (requestedAction == "restore" && numArgs == 1) {
+        action = new RestoreSimulation();
+    } else if (requestedAction == "restore" && numArgs == 2) {
+        action = new RestoreSimulation(string(args[1]));
+    } else if (requestedAction == "flush" && numArgs == 1) {
+        if (writeAheadLog != nullptr) {
+            writeAheadLog->commit();
+        }
+        output->flush();
+        Log::flush();
+        return true;
+    } else if (requestedAction == "logLevel" && numArgs == 2) {
+        LogLevel level;
+        if (Log::parseLevel(args[1], level)) {
+            Log::setLevel(level);
         } else {
-            std::cout << "Unknown command or incorrect number of arguments." << std::endl;
-            continue;
+            *output << "Unknown log level, expected trace, debug, info, error or off." << '\n';
         }
+        return true;
+    } else if (requestedAction == "stats" && numArgs == 1) {
+        Stats::print(*output);
+        return true;
+    } else if (requestedAction == "exit" && numArgs == 1) {
+        return false;
+    } else {
+        *output << "Unknown command or incorrect number of arguments." << '\n';
+        return true;
+    }
+
+    if (action != nullptr) {
+        action->act(*this);
+        addAction(action);
+    }
+    return true;
+}
+
+const ActionJournal &Simulation::getActionsLog() const{
+    return actionsLog;
+}
+
+// Other simulations may run in the same process, so nothing a simulation prints goes through
+// std::cout unless it is the simulation's output
+void Simulation::setOutput(std::ostream &output){
+    this->output = &output;
+}
+
+std::ostream &Simulation::getOutput(){
+    return *output;
+}
+
+int Simulation::getCurrentTick() const{
+    return currentTick;
+}
+
+// addAction only compacts the journal onto a new checkpoint while there is no in-memory backup,
+// until then the files replay reads must stay as they were
+bool Simulation::canSaveCheckpoint(const string &filePath) const{
+    return writeAheadLog == nullptr || backup == nullptr || !writeAheadLog->readsFile(filePath);
+}
+
+// Journals every action from now on; the simulation takes ownership of the log
+void Simulation::setWriteAheadLog(WriteAheadLog *writeAheadLog){
+    if (this->writeAheadLog != nullptr){
+        delete this->writeAheadLog;
+    }
+    this->writeAheadLog = writeAheadLog;
+}
 
-        if (action != nullptr) {
+/*
+Runs the commands of a journal again on a simulation built from the journal's base, printing
+nothing. Commands that only print, checkpoint writes and history entries don't change the world,
+so they go straight into the actions log; the rest are run with the console output discarded,
+whatever status they were journaled with, since running them again on the same world gives the
+same result. Returns the number of commands run.
+*/
+long long Simulation::replay(JournalReader &journal){
+    std::ostream *console = output;
+    std::ostream discard(nullptr);
+    output = &discard;
+    JournalEntry kind;
+    ActionRecord record;
+    long long numRun = 0;
+    while (journal.next(kind, record)){
+        BaseAction *action = journal.getStrings().makeAction(record);
+        bool run = kind == JOURNAL_ACTION
+                   && record.kind != ActionKind::PRINT_PLAN_STATUS && record.kind != ActionKind::PRINT_ACTIONS_LOG
+                   && record.kind != ActionKind::PRINT_AGGREGATE && record.kind != ActionKind::PRINT_TOP_PLANS
+                   && !(record.kind == ActionKind::BACKUP && record.args[0] != -1);
+        if (run){
             action->act(*this);
+            if ((uint8_t)action->getStatus() != record.status){
+                LOG_ERROR("Replayed command '" << action->toString() << "' ended differently than when it was journaled");
+            }
             addAction(action);
+            numRun++;
+        } else {
+            ActionRecord logged = action->toRecord(actionsLog);
+            logged.status = record.status;
+            logged.repeat = record.repeat;
+            actionsLog.append(logged);
+            delete action;
         }
     }
+    output = console;
+    return numRun;
 }
 
-vector<BaseAction*> Simulation::getActionsLog(){
-    return actionsLog;
+// Applies to the plans there are and to the ones added later
+void Simulation::setCompactHistory(bool compact){
+    compactHistory = compact;
+    writablePlans();
+    for (int i = 0; i < (int)plans->size(); i++){
+        writablePlan(i).setCompactHistory(compact);
+    }
+}
+
+// Keeps at most maxRecords distinct log records, dropping the oldest (0 for no limit)
+void Simulation::setLogCapacity(size_t maxRecords){
+    actionsLog.setCapacity(maxRecords);
 }
 
 void Simulation::createBackup(){
+    STATS_TIMER(Phase::BACKUP);
     if (backup != nullptr) {
         delete backup;
     }
-    backup = new Simulation(*this);
+    backup = new SimulationSnapshot{plans, scheduler, scoreTotals, planCounter, currentTick, (int)settlements.size(), facilitiesOptions.size(), actionsLog.getNumLogged()};
 }
 
 void Simulation::getRestore(){
     if (backup == nullptr){
-        std::cerr << "No backup available" << std::endl;
+        *output << "No backup available" << '\n';
         return;
     }
-    *this = *backup;
-}
\ No newline at end of file
+    STATS_TIMER(Phase::RESTORE);
+    // Everything added after the backup is dropped; nothing older was ever modified in place
+    actionsLog.truncate(backup->numActions);
+    while ((int)settlements.size() > backup->numSettlements){
+        settlementIndex.erase(settlements.size() - 1, settlements);
+        delete settlements.back();
+        settlements.pop_back();
+    }
+    facilitiesOptions.truncate(backup->numFacilities);
+    plans = backup->plans;
+    scheduler = backup->scheduler;
+    scoreTotals = backup->scoreTotals;
+    planRanking.invalidate();
+    planCounter = backup->planCounter;
+    currentTick = backup->currentTick;
+}
+
+PlanStore &Simulation::writablePlans(){
+    if (plans.use_count() > 1){
+        plans = std::make_shared<PlanStore>(*plans);
+    }
+    return *plans;
+}
+
+// Callers stepping plans concurrently must call writablePlans().unshareChunks() first
+Plan &Simulation::writablePlan(int index){
+    return writablePlans().writable(index);
+}
+
+ConstructionScheduler &Simulation::writableScheduler(){
+    if (scheduler.use_count() > 1){
+        scheduler = std::make_shared<ConstructionScheduler>(*scheduler);
+    }
+    return *scheduler;
+}
+
+ScoreTotals &Simulation::writableScoreTotals(){
+    if (scoreTotals.use_count() > 1){
+        scoreTotals = std::make_shared<ScoreTotals>(*scoreTotals);
+    }
+    return *scoreTotals;
+}
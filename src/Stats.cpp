@@ -0,0 +1,274 @@
+#include "../include/Stats.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+using std::vector;
+
+static const int NUM_PHASES = (int)Phase::COUNT;
+static const char *const PHASE_NAMES[] = {"simulation_step", "fast_forward", "select_batch", "plan_step", "select_facility",
+                                          "facility_step", "config_load", "backup", "restore", "checkpoint_save", "checkpoint_load"};
+
+/*
+Latency histogram buckets: values below 8 ticks get a bucket each, larger ones 8 buckets per
+power of two, so a percentile read from a bucket is off by at most 1/16 of its value.
+*/
+static const int SUB_BUCKET_BITS = 3;
+static const int NUM_BUCKETS = (64 - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+
+static int bucketOf(uint64_t ticks) {
+    if (ticks < (1u << SUB_BUCKET_BITS)) {
+        return ticks;
+    }
+    int shift = 63 - __builtin_clzll(ticks) - SUB_BUCKET_BITS;
+    return ((shift + 1) << SUB_BUCKET_BITS) + (int)((ticks >> shift) & ((1u << SUB_BUCKET_BITS) - 1));
+}
+
+static double bucketMiddle(int bucket) {
+    if (bucket < (1 << SUB_BUCKET_BITS)) {
+        return bucket;
+    }
+    int shift = (bucket >> SUB_BUCKET_BITS) - 1;
+    uint64_t lower = (uint64_t)((1 << SUB_BUCKET_BITS) + (bucket & ((1 << SUB_BUCKET_BITS) - 1))) << shift;
+    return lower + (double)(1ull << shift) / 2;
+}
+
+// Only the owning thread writes its counters, so a relaxed load and store is enough to add
+static void add(std::atomic<uint64_t> &counter, uint64_t value) {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+struct PhaseCounters {
+    std::atomic<uint64_t> calls{0};
+    std::atomic<uint64_t> timedCalls{0}; //The calls ticks and buckets are made of
+    std::atomic<uint64_t> ticks{0};
+    std::atomic<uint64_t> buckets[NUM_BUCKETS] = {};
+};
+
+struct ThreadStats {
+    PhaseCounters phases[NUM_PHASES];
+    bool inUse = false;
+};
+
+/*
+Every block ever handed out. A thread that exits gives its block back for the next thread to
+record into, so the counts of finished threads (a resized thread pool) are kept.
+*/
+static std::mutex registryMutex;
+static vector<std::unique_ptr<ThreadStats>> registry;
+
+struct ThreadSlot {
+    ThreadStats *stats = nullptr;
+
+    ThreadStats &get() {
+        if (stats == nullptr) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            for (auto &block : registry) {
+                if (!block->inUse) {
+                    stats = block.get();
+                    break;
+                }
+            }
+            if (stats == nullptr) {
+                registry.emplace_back(new ThreadStats());
+                stats = registry.back().get();
+            }
+            stats->inUse = true;
+        }
+        return *stats;
+    }
+
+    ~ThreadSlot() {
+        if (stats != nullptr) {
+            std::lock_guard<std::mutex> lock(registryMutex);
+            stats->inUse = false;
+        }
+    }
+};
+
+static thread_local ThreadSlot threadSlot;
+
+void Stats::record(Phase phase, uint64_t ticks) {
+    add(threadSlot.get().phases[(int)phase].calls, 1);
+    recordSample(phase, ticks);
+}
+
+bool Stats::count(Phase phase) {
+    std::atomic<uint64_t> &calls = threadSlot.get().phases[(int)phase].calls;
+    uint64_t call = calls.load(std::memory_order_relaxed);
+    calls.store(call + 1, std::memory_order_relaxed);
+    return call < STATS_SAMPLE_PERIOD || (call & (STATS_SAMPLE_PERIOD - 1)) == 0;
+}
+
+void Stats::recordSample(Phase phase, uint64_t ticks) {
+    PhaseCounters &counters = threadSlot.get().phases[(int)phase];
+    add(counters.timedCalls, 1);
+    add(counters.ticks, ticks);
+    add(counters.buckets[bucketOf(ticks)], 1);
+}
+
+// The timer clock against steady_clock since the program started
+static const uint64_t originTicks = Stats::now();
+static const std::chrono::steady_clock::time_point originTime = std::chrono::steady_clock::now();
+
+double Stats::ticksPerSecond() {
+#if defined(__x86_64__) || defined(__i386__)
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - originTime).count();
+    uint64_t ticks = Stats::now() - originTicks;
+    return seconds > 0 && ticks > 0 ? ticks / seconds : 1e9;
+#else
+    return 1e9;
+#endif
+}
+
+struct PhaseSummary {
+    uint64_t calls;
+    double seconds;
+    double p50, p99; //Seconds
+};
+
+static double percentile(const vector<uint64_t> &buckets, uint64_t calls, double fraction) {
+    uint64_t rank = (uint64_t)(fraction * (calls - 1)) + 1;
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+        seen += buckets[bucket];
+        if (seen >= rank) {
+            return bucketMiddle(bucket);
+        }
+    }
+    return 0;
+}
+
+// Adds up the blocks of all threads
+static vector<PhaseSummary> summarize() {
+    vector<PhaseSummary> summaries(NUM_PHASES);
+    double tickSeconds = 1 / Stats::ticksPerSecond();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    for (int phase = 0; phase < NUM_PHASES; phase++) {
+        vector<uint64_t> buckets(NUM_BUCKETS, 0);
+        uint64_t calls = 0, timedCalls = 0, ticks = 0;
+        for (auto &block : registry) {
+            const PhaseCounters &counters = block->phases[phase];
+            calls += counters.calls.load(std::memory_order_relaxed);
+            timedCalls += counters.timedCalls.load(std::memory_order_relaxed);
+            ticks += counters.ticks.load(std::memory_order_relaxed);
+            for (int bucket = 0; bucket < NUM_BUCKETS; bucket++) {
+                buckets[bucket] += counters.buckets[bucket].load(std::memory_order_relaxed);
+            }
+        }
+        // A reader racing the writers can see a call before its bucket; the percentiles then
+        // come from the calls that are complete
+        uint64_t counted = 0;
+        for (uint64_t count : buckets) {
+            counted += count;
+        }
+        PhaseSummary &summary = summaries[phase];
+        summary.calls = calls;
+        summary.seconds = timedCalls > 0 ? ticks * tickSeconds * calls / timedCalls : 0; //Scaled up for sampled phases
+        summary.p50 = counted > 0 ? percentile(buckets, counted, 0.5) * tickSeconds : 0;
+        summary.p99 = counted > 0 ? percentile(buckets, counted, 0.99) * tickSeconds : 0;
+    }
+    return summaries;
+}
+
+void Stats::print(std::ostream &out) {
+    vector<PhaseSummary> summaries = summarize();
+    std::ios::fmtflags flags = out.flags();
+    out << std::left << std::setw(16) << "Phase" << std::right << std::setw(12) << "Calls" << std::setw(12) << "Total ms"
+        << std::setw(12) << "Mean us" << std::setw(12) << "p50 us" << std::setw(12) << "p99 us" << '\n';
+    out << std::fixed << std::setprecision(3);
+    for (int phase = 0; phase < NUM_PHASES; phase++) {
+        const PhaseSummary &summary = summaries[phase];
+        double mean = summary.calls > 0 ? summary.seconds / summary.calls : 0;
+        out << std::left << std::setw(16) << PHASE_NAMES[phase] << std::right << std::setw(12) << summary.calls
+            << std::setw(12) << summary.seconds * 1e3 << std::setw(12) << mean * 1e6 << std::setw(12) << summary.p50 * 1e6
+            << std::setw(12) << summary.p99 * 1e6 << '\n';
+    }
+    out.flags(flags);
+}
+
+/*
+Prometheus text format, one summary per phase:
+    simulation_phase_seconds{phase="plan_step",quantile="0.5"} 1.2e-07
+    simulation_phase_seconds_sum{phase="plan_step"} 0.84
+    simulation_phase_seconds_count{phase="plan_step"} 7000000
+The file is written next to its path and renamed over it, so a scraper never reads half of it.
+*/
+bool Stats::writePrometheus(const string &filePath) {
+    vector<PhaseSummary> summaries = summarize();
+    string tempPath = filePath + ".tmp";
+    {
+        std::ofstream out(tempPath);
+        out << "# HELP simulation_phase_seconds Time spent in each phase of the simulation.\n";
+        out << "# TYPE simulation_phase_seconds summary\n";
+        out << std::setprecision(9);
+        for (int phase = 0; phase < NUM_PHASES; phase++) {
+            const PhaseSummary &summary = summaries[phase];
+            string label = string("{phase=\"") + PHASE_NAMES[phase] + "\"";
+            out << "simulation_phase_seconds" << label << ",quantile=\"0.5\"} " << summary.p50 << '\n';
+            out << "simulation_phase_seconds" << label << ",quantile=\"0.99\"} " << summary.p99 << '\n';
+            out << "simulation_phase_seconds_sum" << label << "} " << summary.seconds << '\n';
+            out << "simulation_phase_seconds_count" << label << "} " << summary.calls << '\n';
+        }
+        if (!out.flush()) {
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+    return std::rename(tempPath.c_str(), filePath.c_str()) == 0;
+}
+
+// The background thread behind startDump
+struct StatsDump {
+    std::mutex mutex;
+    std::condition_variable stopped;
+    std::thread writer;
+    string filePath;
+    bool started = false;
+    bool stopping = false;
+
+    ~StatsDump() {
+        stop();
+    }
+
+    void run(std::chrono::seconds interval) {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopped.wait_for(lock, interval, [this] { return stopping; })) {
+            Stats::writePrometheus(filePath);
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!started) {
+                return;
+            }
+            stopping = true;
+        }
+        stopped.notify_one();
+        writer.join();
+        started = false;
+        stopping = false;
+        Stats::writePrometheus(filePath);
+    }
+};
+
+static StatsDump dump;
+
+void Stats::startDump(const string &filePath, int intervalSeconds) {
+    shutdown();
+    dump.filePath = filePath;
+    dump.started = true;
+    dump.writer = std::thread(&StatsDump::run, &dump, std::chrono::seconds(intervalSeconds));
+}
+
+void Stats::shutdown() {
+    dump.stop();
+}
@@ -0,0 +1,134 @@
+#include "../include/ThreadPool.h"
+
+ThreadPool::ThreadPool(int numThreads)
+    : numThreads(numThreads < 1 ? 1 : numThreads), task(nullptr), failure(nullptr), pendingChunks(0), generation(0), stopping(false) {
+    for (int i = 0; i < this->numThreads; i++) {
+        queues.push_back(new ChunkQueue());
+    }
+    // Worker 0 is the thread calling parallelFor, so only numThreads-1 threads are spawned
+    for (int i = 1; i < this->numThreads; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeWorkers.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    for (ChunkQueue *queue : queues) {
+        delete queue;
+    }
+}
+
+int ThreadPool::getNumThreads() const {
+    return numThreads;
+}
+
+void ThreadPool::parallelFor(int count, int chunkSize, const std::function<void(int, int)> &task) {
+    if (count <= 0) {
+        return;
+    }
+    if (chunkSize < 1) {
+        chunkSize = 1;
+    }
+    if (numThreads == 1 || count <= chunkSize) {
+        task(0, count);
+        return;
+    }
+
+    // The task has to be published before any chunk becomes visible to a worker
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        this->task = &task;
+        failure = nullptr;
+        pendingChunks = (count + chunkSize - 1) / chunkSize;
+        generation++;
+    }
+    int chunkIndex = 0;
+    for (int begin = 0; begin < count; begin += chunkSize) {
+        int end = begin + chunkSize < count ? begin + chunkSize : count;
+        ChunkQueue *queue = queues[chunkIndex % numThreads];
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->chunks.emplace_back(begin, end);
+        chunkIndex++;
+    }
+    wakeWorkers.notify_all();
+
+    while (runChunk(0)) {
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    jobDone.wait(lock, [this] { return pendingChunks == 0; });
+    this->task = nullptr;
+    if (failure != nullptr) {
+        std::exception_ptr error = failure;
+        failure = nullptr;
+        std::rethrow_exception(error);
+    }
+}
+
+void ThreadPool::workerLoop(int workerId) {
+    int seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeWorkers.wait(lock, [this, seenGeneration] { return stopping || generation != seenGeneration; });
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+        while (runChunk(workerId)) {
+        }
+    }
+}
+
+bool ThreadPool::popChunk(int workerId, std::pair<int, int> &chunk) {
+    // Own queue first (front), then steal from the back of the others
+    for (int i = 0; i < numThreads; i++) {
+        ChunkQueue *queue = queues[(workerId + i) % numThreads];
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        if (queue->head == queue->chunks.size()) {
+            continue;
+        }
+        if (i == 0) {
+            chunk = queue->chunks[queue->head++];
+        } else {
+            chunk = queue->chunks.back();
+            queue->chunks.pop_back();
+        }
+        if (queue->head == queue->chunks.size()) {
+            queue->chunks.clear();
+            queue->head = 0;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool ThreadPool::runChunk(int workerId) {
+    std::pair<int, int> chunk;
+    if (!popChunk(workerId, chunk)) {
+        return false;
+    }
+    std::exception_ptr error = nullptr;
+    try {
+        (*task)(chunk.first, chunk.second);
+    } catch (...) {
+        error = std::current_exception();
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (error != nullptr && failure == nullptr) {
+        failure = error;
+    }
+    pendingChunks--;
+    if (pendingChunks == 0) {
+        jobDone.notify_all();
+    }
+    return true;
+}
@@ -0,0 +1,126 @@
+#include "../include/Trace.h"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+using std::vector;
+
+std::atomic<bool> Trace::enabled(false);
+
+static const size_t MAX_EVENTS_PER_THREAD = 4 << 20; //128 MB of events; later ones are dropped and counted
+
+struct TraceEvent {
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+    int id; //-1 if none
+    int textIndex; //Into the thread's texts, -1 if none
+};
+
+struct ThreadTrace {
+    int threadId;
+    vector<TraceEvent> events;
+    vector<string> texts;
+    uint64_t dropped = 0;
+};
+
+/*
+Every buffer ever handed out, in the order threads first traced something. A thread's buffer
+outlives the thread, so the events of a resized thread pool are still written.
+*/
+static std::mutex registryMutex;
+static vector<std::unique_ptr<ThreadTrace>> registry;
+static string traceFilePath;
+static uint64_t traceStart;
+
+static thread_local ThreadTrace *threadTrace = nullptr;
+
+void Trace::start(const string &filePath) {
+    traceFilePath = filePath;
+    traceStart = Stats::now();
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+void Trace::record(const char *name, uint64_t start, uint64_t end, int id, std::string_view text) {
+    if (threadTrace == nullptr) {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        registry.emplace_back(new ThreadTrace());
+        threadTrace = registry.back().get();
+        threadTrace->threadId = registry.size();
+    }
+    if (threadTrace->events.size() == MAX_EVENTS_PER_THREAD) {
+        threadTrace->dropped++;
+        return;
+    }
+    int textIndex = -1;
+    if (!text.empty()) {
+        textIndex = threadTrace->texts.size();
+        threadTrace->texts.emplace_back(text);
+    }
+    threadTrace->events.push_back(TraceEvent{name, start, end, id, textIndex});
+}
+
+static void writeJsonString(std::ostream &out, const string &text) {
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if ((unsigned char)c < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out << escaped;
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+/*
+{"traceEvents": [
+  {"name": "thread_name", "ph": "M", "pid": 1, "tid": 1, "args": {"name": "main"}},
+  {"name": "plan_step", "ph": "X", "ts": 12.345, "dur": 0.210, "pid": 1, "tid": 2, "args": {"id": 7}},
+  ...
+], "displayTimeUnit": "ns"}
+Times are in microseconds from Trace::start.
+*/
+void Trace::shutdown() {
+    if (!enabled.exchange(false)) {
+        return;
+    }
+    double microsecondsPerTick = 1e6 / Stats::ticksPerSecond();
+    std::ofstream out(traceFilePath);
+    out << "{\"traceEvents\": [\n";
+    std::lock_guard<std::mutex> lock(registryMutex);
+    uint64_t dropped = 0;
+    bool first = true;
+    char number[64];
+    for (const auto &thread : registry) {
+        out << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << thread->threadId
+            << ", \"args\": {\"name\": \"" << (thread->threadId == 1 ? "main" : "thread " + std::to_string(thread->threadId)) << "\"}}";
+        first = false;
+        for (const TraceEvent &event : thread->events) {
+            std::snprintf(number, sizeof(number), "%.3f, \"dur\": %.3f", (event.start - traceStart) * microsecondsPerTick,
+                          (event.end - event.start) * microsecondsPerTick);
+            out << ",\n{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"ts\": " << number << ", \"pid\": 1, \"tid\": " << thread->threadId;
+            if (event.textIndex != -1) {
+                out << ", \"args\": {\"text\": ";
+                writeJsonString(out, thread->texts[event.textIndex]);
+                out << "}";
+            } else if (event.id != -1) {
+                out << ", \"args\": {\"id\": " << event.id << "}";
+            }
+            out << "}";
+        }
+        dropped += thread->dropped;
+    }
+    out << "\n], \"displayTimeUnit\": \"ns\"}\n";
+    if (!out.flush()) {
+        std::cerr << "Error: failed writing trace " << traceFilePath << std::endl;
+    }
+    if (dropped > 0) {
+        std::cerr << "Warning: trace buffers were full, " << dropped << " events were dropped" << std::endl;
+    }
+}
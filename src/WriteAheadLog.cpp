@@ -0,0 +1,314 @@
+#include "../include/WriteAheadLog.h"
+#include "../include/Auxiliary.h"
+#include <cstring>
+#include <cstdio>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// The file layout is described in include/WriteAheadLog.h
+
+static const size_t GROUP_COMMIT_BYTES = 64 * 1024; //A block is committed once it gets this big
+
+// Bit i is set if args[i] of the record is a string id
+static int stringArgs(const ActionRecord &record) {
+    switch (record.kind) {
+        case ActionKind::ADD_SETTLEMENT:
+        case ActionKind::ADD_FACILITY:
+            return 1;
+        case ActionKind::ADD_PLAN:
+            return 3;
+        case ActionKind::CHANGE_PLAN_POLICY:
+        case ActionKind::PRINT_TOP_PLANS:
+            return 2;
+        case ActionKind::BACKUP:
+        case ActionKind::RESTORE:
+        case ActionKind::PRINT_AGGREGATE:
+            return record.args[0] != -1 ? 1 : 0;
+        default:
+            return 0;
+    }
+}
+
+// The checkpoint a record restores from, or an empty string
+static string restoredPath(const ActionRecord &record, const ActionJournal &strings) {
+    if (record.kind == ActionKind::RESTORE && record.args[0] != -1) {
+        return strings.getString(record.args[0]);
+    }
+    return string();
+}
+
+// Creates (or truncates) a journal holding only its header, returns the descriptor or -1
+static int createFile(const string &filePath, JournalBase base, const string &basePath) {
+    int fd = ::open(filePath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1) {
+        return -1;
+    }
+    string header(sizeof(JournalHeader), '\0');
+    JournalHeader *fields = reinterpret_cast<JournalHeader*>(&header[0]);
+    std::memcpy(fields->magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    fields->version = JOURNAL_VERSION;
+    fields->base = base;
+    fields->basePathLength = basePath.size();
+    header += basePath;
+    if (write(fd, header.data(), header.size()) != (ssize_t)header.size() || fdatasync(fd) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+WriteAheadLog::WriteAheadLog() : fd(-1) {}
+
+WriteAheadLog::~WriteAheadLog() {
+    commit();
+    if (fd != -1) {
+        ::close(fd);
+    }
+}
+
+bool WriteAheadLog::create(const string &filePath, JournalBase base, const string &basePath) {
+    fd = createFile(filePath, base, basePath);
+    if (fd == -1) {
+        std::cerr << "Error: cannot create journal " << filePath << std::endl;
+        return false;
+    }
+    this->filePath = filePath;
+    sourcePaths.assign(1, basePath);
+    return true;
+}
+
+// Continues a journal that was just replayed, cutting off a torn last block
+bool WriteAheadLog::reopen(const string &filePath, const JournalReader &journal) {
+    fd = ::open(filePath.c_str(), O_WRONLY);
+    if (fd == -1 || ftruncate(fd, journal.getValidSize()) != 0 || lseek(fd, 0, SEEK_END) == -1) {
+        std::cerr << "Error: cannot append to journal " << filePath << std::endl;
+        return false;
+    }
+    this->filePath = filePath;
+    const ActionJournal &fileStrings = journal.getStrings();
+    for (int id = 0; id < fileStrings.getNumStrings(); id++) {
+        stringIds.emplace(fileStrings.getString(id), id);
+    }
+    sourcePaths = journal.getSourcePaths();
+    return true;
+}
+
+// The record's strings are looked up in the log it was made for
+void WriteAheadLog::append(const ActionRecord &record, const ActionJournal &log) {
+    addEntry(JOURNAL_ACTION, record, log);
+    // Even a failed restore is run again on replay, and the file may exist by then
+    string restored = restoredPath(record, log);
+    if (!restored.empty()) {
+        sourcePaths.push_back(restored);
+    }
+    if (pending.size() >= GROUP_COMMIT_BYTES) {
+        commit();
+    }
+}
+
+// Writes everything appended since the last commit as one block and waits for it to reach the disk
+void WriteAheadLog::commit() {
+    if (fd != -1 && !writeBlock(fd)) {
+        std::cerr << "Error: failed writing journal " << filePath << std::endl;
+    }
+}
+
+/*
+Replaces the journal with one based on the checkpoint just saved, carrying the actions log over
+as history. The new journal is written next to the old one and renamed over it, so a crash
+leaves one or the other.
+*/
+bool WriteAheadLog::compact(const string &checkpointPath, const ActionJournal &log) {
+    commit();
+    string tempPath = filePath + ".tmp";
+    int newFd = createFile(tempPath, BASE_CHECKPOINT, checkpointPath);
+    if (newFd == -1) {
+        std::cerr << "Error: cannot compact journal " << filePath << std::endl;
+        return false;
+    }
+    std::unordered_map<string, int> newStringIds;
+    stringIds.swap(newStringIds);
+    for (size_t i = 0; i < log.getNumRecords(); i++) {
+        addEntry(JOURNAL_HISTORY, log.getRecord(i), log);
+    }
+    if (!writeBlock(newFd) || std::rename(tempPath.c_str(), filePath.c_str()) != 0) {
+        std::cerr << "Error: cannot compact journal " << filePath << std::endl;
+        ::close(newFd);
+        std::remove(tempPath.c_str());
+        stringIds.swap(newStringIds);
+        return false;
+    }
+    if (!Auxiliary::syncParentDirectory(filePath)) {
+        std::cerr << "Error: cannot sync the directory of journal " << filePath << std::endl;
+    }
+    ::close(fd);
+    fd = newFd;
+    sourcePaths.assign(1, checkpointPath);
+    return true;
+}
+
+// Paths are compared as files when both exist, so "./c1" is the same checkpoint as "c1"
+bool WriteAheadLog::readsFile(const string &path) const {
+    struct stat target;
+    bool exists = ::stat(path.c_str(), &target) == 0;
+    for (const string &source : sourcePaths) {
+        struct stat read;
+        if (source == path || (exists && ::stat(source.c_str(), &read) == 0 && read.st_dev == target.st_dev && read.st_ino == target.st_ino)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void WriteAheadLog::addEntry(JournalEntry kind, const ActionRecord &record, const ActionJournal &log) {
+    ActionRecord fileRecord = record;
+    int strings = stringArgs(record);
+    for (int i = 0; strings != 0; i++, strings >>= 1) {
+        if (strings & 1) {
+            fileRecord.args[i] = fileStringId(record.args[i], log);
+        }
+    }
+    if (pending.empty()) {
+        pending.resize(sizeof(JournalBlockHeader)); //Filled in by writeBlock
+    }
+    pending.push_back(kind);
+    pending.append(reinterpret_cast<const char*>(&fileRecord), sizeof(fileRecord));
+}
+
+// A string is written to the file the first time a record refers to it
+int WriteAheadLog::fileStringId(int logStringId, const ActionJournal &log) {
+    const string &text = log.getString(logStringId);
+    auto found = stringIds.find(text);
+    if (found != stringIds.end()) {
+        return found->second;
+    }
+    int id = stringIds.size();
+    stringIds.emplace(text, id);
+    if (pending.empty()) {
+        pending.resize(sizeof(JournalBlockHeader));
+    }
+    uint32_t length = text.size();
+    pending.push_back(JOURNAL_STRING);
+    pending.append(reinterpret_cast<const char*>(&length), sizeof(length));
+    pending += text;
+    return id;
+}
+
+bool WriteAheadLog::writeBlock(int fd) {
+    if (pending.empty()) {
+        return true;
+    }
+    JournalBlockHeader header = {(uint32_t)(pending.size() - sizeof(header)), 0, 0};
+    header.checksum = Auxiliary::fnv1a(pending.data() + sizeof(header), header.payloadSize);
+    std::memcpy(&pending[0], &header, sizeof(header));
+    bool written = Auxiliary::writeAll(fd, pending.data(), pending.size()) && fdatasync(fd) == 0;
+    pending.clear();
+    return written;
+}
+
+JournalReader::JournalReader() : base(BASE_CONFIG), position(0), blockEnd(0), validSize(0), torn(false) {}
+
+bool JournalReader::open(const string &filePath) {
+    JournalHeader header;
+    if (!file.open(filePath) || file.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 || header.version == 0 || header.version > JOURNAL_VERSION
+        || header.base > BASE_CHECKPOINT || header.basePathLength > file.size() - sizeof(header)) {
+        return false;
+    }
+    base = static_cast<JournalBase>(header.base);
+    basePath.assign(file.data() + sizeof(header), header.basePathLength);
+    sourcePaths.assign(1, basePath);
+    position = blockEnd = validSize = sizeof(header) + header.basePathLength;
+    return true;
+}
+
+JournalBase JournalReader::getBase() const {
+    return base;
+}
+
+const string &JournalReader::getBasePath() const {
+    return basePath;
+}
+
+const ActionJournal &JournalReader::getStrings() const {
+    return strings;
+}
+
+uint64_t JournalReader::getValidSize() const {
+    return validSize;
+}
+
+bool JournalReader::isTorn() const {
+    return torn;
+}
+
+const std::vector<string> &JournalReader::getSourcePaths() const {
+    return sourcePaths;
+}
+
+bool JournalReader::next(JournalEntry &kind, ActionRecord &record) {
+    while (!torn) {
+        if (position == blockEnd && !nextBlock()) {
+            return false;
+        }
+        const char *data = file.data();
+        uint8_t tag = data[position];
+        if (tag == JOURNAL_STRING && blockEnd - position >= 1 + sizeof(uint32_t)) {
+            uint32_t length;
+            std::memcpy(&length, data + position + 1, sizeof(length));
+            if (length <= blockEnd - position - 1 - sizeof(length)) {
+                strings.intern(std::string_view(data + position + 1 + sizeof(length), length));
+                position += 1 + sizeof(length) + length;
+                continue;
+            }
+        } else if ((tag == JOURNAL_ACTION || tag == JOURNAL_HISTORY) && blockEnd - position >= 1 + sizeof(record)) {
+            std::memcpy(&record, data + position + 1, sizeof(record));
+            bool valid = record.kind <= ActionKind::PRINT_TOP_PLANS;
+            int stringIds = valid ? stringArgs(record) : 0;
+            for (int i = 0; stringIds != 0; i++, stringIds >>= 1) {
+                if ((stringIds & 1) && (record.args[i] < 0 || record.args[i] >= strings.getNumStrings())) {
+                    valid = false;
+                }
+            }
+            if (valid) {
+                kind = static_cast<JournalEntry>(tag);
+                position += 1 + sizeof(record);
+                string restored = kind == JOURNAL_ACTION ? restoredPath(record, strings) : string();
+                if (!restored.empty()) {
+                    sourcePaths.push_back(restored);
+                }
+                return true;
+            }
+        }
+        // A block that passed its checksum but does not parse: stop before it
+        torn = true;
+    }
+    return false;
+}
+
+// Steps into the next block if it is complete and its checksum matches
+bool JournalReader::nextBlock() {
+    JournalBlockHeader header;
+    validSize = position; //Everything before this block has been read
+    if (position == file.size()) {
+        return false;
+    }
+    if (file.size() - position < sizeof(header)) {
+        torn = true;
+        return false;
+    }
+    std::memcpy(&header, file.data() + position, sizeof(header));
+    if (header.payloadSize > file.size() - position - sizeof(header)
+        || Auxiliary::fnv1a(file.data() + position + sizeof(header), header.payloadSize) != header.checksum) {
+        torn = true;
+        return false;
+    }
+    position += sizeof(header);
+    blockEnd = position + header.payloadSize;
+    return true;
+}
@@ -3,24 +3,159 @@
 #include "../include/Settlement.h"
 #include "../include/SelectionPolicy.h"
 #include "../include/Plan.h"
+#include "../include/Auxiliary.h"
+#include "../include/LineReader.h"
+#include "../include/WriteAheadLog.h"
+#include "../include/Log.h"
+#include "../include/Stats.h"
+#include "../include/Trace.h"
 #include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
 #pragma once
 using namespace std;
 
-Simulation* backup = nullptr;
-
 int main(int argc, char** argv){
-    if(argc!=2){
-        cout << "usage: simulation <config_path>" << endl;
+    string usage = "usage: simulation <config_path> | --from-checkpoint <file> [--threads N] [--script <commands_file>] [--log-level trace|debug|info|error|off] [--log-capacity N] [--compact-history] [--journal <file>] [--stats-file <file> [--stats-interval SECONDS]] [--trace <file>] | --replay <journal>";
+    string configurationFile;
+    string checkpointFile;
+    string scriptFile;
+    string journalFile;
+    string replayFile;
+    string statsFile;
+    string traceFile;
+    int numThreads = 1;
+    long logCapacity = 0;
+    int statsInterval = 10;
+    bool compactHistory = false;
+    LogLevel logLevel = Log::getLevel();
+    for(int i=1; i<argc; i++){
+        string arg = argv[i];
+        if(arg=="--threads" && i+1<argc && atoi(argv[i+1])>=1){
+            numThreads = atoi(argv[++i]);
+        } else if(arg=="--from-checkpoint" && i+1<argc && checkpointFile.empty()){
+            checkpointFile = argv[++i];
+        } else if(arg=="--log-level" && i+1<argc && Log::parseLevel(argv[i+1], logLevel)){
+            i++;
+        } else if(arg=="--log-capacity" && i+1<argc && atol(argv[i+1])>=1){
+            logCapacity = atol(argv[++i]);
+        } else if(arg=="--compact-history"){
+            compactHistory = true;
+        } else if(arg=="--journal" && i+1<argc && journalFile.empty()){
+            journalFile = argv[++i];
+        } else if(arg=="--replay" && i+1<argc && replayFile.empty()){
+            replayFile = argv[++i];
+        } else if(arg=="--stats-file" && i+1<argc && statsFile.empty()){
+            statsFile = argv[++i];
+        } else if(arg=="--stats-interval" && i+1<argc && atoi(argv[i+1])>=1){
+            statsInterval = atoi(argv[++i]);
+        } else if(arg=="--trace" && i+1<argc && traceFile.empty()){
+            traceFile = argv[++i];
+        } else if(arg=="--script" && i+1<argc && scriptFile.empty()){
+            scriptFile = argv[++i];
+        } else if(arg.compare(0, 2, "--")!=0 && configurationFile.empty()){
+            configurationFile = arg;
+        } else {
+            cout << usage << endl;
+            return 0;
+        }
+    }
+    int numSources = !configurationFile.empty() + !checkpointFile.empty() + !replayFile.empty();
+    if(numSources!=1 || (!replayFile.empty() && !journalFile.empty())){
+        cout << usage << endl;
         return 0;
     }
-    string configurationFile = argv[1];
-    
-    Simulation simulation(configurationFile);
-    simulation.start();
-    if(backup!=nullptr){
-    	delete backup;
-    	backup = nullptr;
+
+    Log::setLevel(logLevel);
+    if(!statsFile.empty()){
+        Stats::startDump(statsFile, statsInterval);
+    }
+    if(!traceFile.empty()){
+        Trace::start(traceFile);
+    }
+
+    // Batch mode when commands come from a script or a pipe: nobody reads the output line by line
+    int commandsFd = STDIN_FILENO;
+    if(!scriptFile.empty()){
+        commandsFd = open(scriptFile.c_str(), O_RDONLY);
+        if(commandsFd==-1){
+            cerr << "Error: cannot open script " << scriptFile << endl;
+            return 1;
+        }
+    }
+    bool batch = commandsFd!=STDIN_FILENO || !isatty(STDIN_FILENO);
+    Auxiliary::setBatchOutput(batch);
+
+    // A replayed journal names the configuration or checkpoint its commands apply to
+    JournalReader *journal = nullptr;
+    if(!replayFile.empty()){
+        journal = new JournalReader();
+        if(!journal->open(replayFile)){
+            cerr << "Error: cannot read journal " << replayFile << endl;
+            delete journal;
+            Auxiliary::setBatchOutput(false);
+            Stats::shutdown();
+            Trace::shutdown();
+            Log::shutdown();
+            return 1;
+        }
+        if(journal->getBase()==BASE_CONFIG){
+            configurationFile = journal->getBasePath();
+        } else {
+            checkpointFile = journal->getBasePath();
+        }
+    }
+
+    Simulation *simulation = checkpointFile.empty() ? new Simulation(configurationFile) : new Simulation();
+    bool ready = checkpointFile.empty() || simulation->loadCheckpoint(checkpointFile);
+    WriteAheadLog *writeAheadLog = nullptr;
+    if(ready && journal!=nullptr){
+        long long numRun = simulation->replay(*journal);
+        LOG_INFO("Replayed " << numRun << " commands from " << replayFile);
+        if(journal->isTorn()){
+            cerr << "Warning: journal " << replayFile << " ends with an incomplete block, replayed up to it" << endl;
+        }
+        // Later commands go on to the same journal
+        writeAheadLog = new WriteAheadLog();
+        ready = writeAheadLog->reopen(replayFile, *journal);
+    } else if(ready && !journalFile.empty()){
+        writeAheadLog = new WriteAheadLog();
+        ready = checkpointFile.empty() ? writeAheadLog->create(journalFile, BASE_CONFIG, configurationFile)
+                                       : writeAheadLog->create(journalFile, BASE_CHECKPOINT, checkpointFile);
+    }
+    if(journal!=nullptr){
+        delete journal;
+    }
+    if(!ready){
+        if(writeAheadLog!=nullptr){
+            delete writeAheadLog;
+        }
+        delete simulation;
+        Auxiliary::setBatchOutput(false);
+        Stats::shutdown();
+        Trace::shutdown();
+        Log::shutdown();
+        return 1;
+    }
+    if(writeAheadLog!=nullptr){
+        simulation->setWriteAheadLog(writeAheadLog);
+    }
+    simulation->setNumThreads(numThreads);
+    simulation->setLogCapacity(logCapacity);
+    simulation->setCompactHistory(compactHistory);
+    if(batch){
+        LineReader commands(commandsFd);
+        simulation->start(commands);
+    } else {
+        simulation->start();
+    }
+    delete simulation;
+    Auxiliary::setBatchOutput(false);
+    Stats::shutdown();
+    Trace::shutdown();
+    Log::shutdown();
+    if(commandsFd!=STDIN_FILENO){
+        close(commandsFd);
     }
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,209 @@
+#include "../include/Simulation.h"
+#include "../include/Action.h"
+#include "../include/LineReader.h"
+#include "../include/ThreadPool.h"
+#include "../include/Log.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+using std::string;
+using std::vector;
+
+/*
+Runs a batch of independent scenarios, each a configuration file plus a command script, in one
+process, and writes one CSV row per scenario.
+
+    sweep [--threads N] [--output-dir DIR] [--csv FILE] [--log-level LEVEL] <manifest>
+
+The manifest lists one scenario per line, "<config_file> <commands_file>", paths relative to the
+working directory; blank lines and lines starting with # are skipped. Scenarios are handed out
+one at a time to a work-stealing ThreadPool (default: one thread per core), and each builds, runs
+and drops its own Simulation, so the process holds at most one simulation per thread. What a
+scenario prints, error messages included, goes to DIR/<scenario>.out with --output-dir, and is
+discarded otherwise.
+Files a script names (backup/restore checkpoints, journals) are not made per scenario: scripts
+that share a path see each other's files.
+
+CSV columns, in manifest order whatever the order scenarios finished in:
+    scenario,config,script,status,load_seconds,run_seconds,commands,errors,ticks,plans,
+    life_quality,economy,environment
+status is ok, missing config, missing script or "failed: <reason>"; the scores are the totals
+over all plans at the end of the script (see ScoreTotals).
+*/
+
+struct Scenario {
+    string configPath;
+    string scriptPath;
+};
+
+struct ScenarioResult {
+    string status;
+    double loadSeconds = 0;
+    double runSeconds = 0;
+    long long numCommands = 0;
+    long long numErrors = 0;
+    int ticks = 0;
+    ScoreTotal totals = {0, 0, 0, 0};
+};
+
+static bool readManifest(const string &path, vector<Scenario> &scenarios) {
+    std::ifstream manifest(path);
+    if (!manifest.is_open()) {
+        return false;
+    }
+    string line;
+    while (std::getline(manifest, line)) {
+        std::istringstream fields(line);
+        Scenario scenario;
+        if (!(fields >> scenario.configPath) || scenario.configPath[0] == '#') {
+            continue;
+        }
+        if (!(fields >> scenario.scriptPath)) {
+            std::cerr << "Error: manifest line without a commands file: " << line << std::endl;
+            return false;
+        }
+        scenarios.push_back(scenario);
+    }
+    return true;
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void runScenario(int index, const Scenario &scenario, const string &outputDir, ScenarioResult &result) {
+    if (!std::ifstream(scenario.configPath).good()) {
+        result.status = "missing config";
+        return;
+    }
+    int commandsFd = ::open(scenario.scriptPath.c_str(), O_RDONLY);
+    if (commandsFd == -1) {
+        result.status = "missing script";
+        return;
+    }
+    std::ofstream outputFile;
+    std::ostream discard(nullptr);
+    if (!outputDir.empty()) {
+        outputFile.open(outputDir + "/" + std::to_string(index) + ".out");
+    }
+    try {
+        auto start = std::chrono::steady_clock::now();
+        Simulation simulation(scenario.configPath);
+        result.loadSeconds = secondsSince(start);
+        simulation.setOutput(outputFile.is_open() ? static_cast<std::ostream&>(outputFile) : discard);
+        start = std::chrono::steady_clock::now();
+        LineReader commands(commandsFd);
+        simulation.start(commands);
+        result.runSeconds = secondsSince(start);
+
+        const ActionJournal &log = simulation.getActionsLog();
+        result.numCommands = log.getNumLogged();
+        for (size_t i = 0; i < log.getNumRecords(); i++) {
+            const ActionRecord &record = log.getRecord(i);
+            if (record.status == (uint8_t)ActionStatus::ERROR) {
+                result.numErrors += record.repeat;
+            }
+        }
+        result.ticks = simulation.getCurrentTick();
+        result.totals = simulation.getScoreTotals().getGlobal();
+        result.status = "ok";
+    } catch (const std::exception &e) {
+        result.status = string("failed: ") + e.what();
+    }
+    ::close(commandsFd);
+}
+
+// Quoted when it holds a separator, a quote or a line break
+static string csvField(const string &text) {
+    if (text.find_first_of(",\"\n") == string::npos) {
+        return text;
+    }
+    string quoted = "\"";
+    for (char c : text) {
+        quoted += c;
+        if (c == '"') {
+            quoted += '"';
+        }
+    }
+    return quoted + "\"";
+}
+
+int main(int argc, char** argv) {
+    const char *usage = "usage: sweep [--threads N] [--output-dir DIR] [--csv FILE] [--log-level trace|debug|info|error|off] <manifest>";
+    int numThreads = std::thread::hardware_concurrency() > 0 ? std::thread::hardware_concurrency() : 1;
+    string outputDir, csvPath = "-", manifestPath;
+    LogLevel logLevel = Log::getLevel();
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc && atoi(argv[i + 1]) >= 1) {
+            numThreads = atoi(argv[++i]);
+        } else if (arg == "--output-dir" && i + 1 < argc) {
+            outputDir = argv[++i];
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csvPath = argv[++i];
+        } else if (arg == "--log-level" && i + 1 < argc && Log::parseLevel(argv[i + 1], logLevel)) {
+            i++;
+        } else if (arg.compare(0, 2, "--") != 0 && manifestPath.empty()) {
+            manifestPath = arg;
+        } else {
+            std::cerr << usage << std::endl;
+            return 1;
+        }
+    }
+    if (manifestPath.empty()) {
+        std::cerr << usage << std::endl;
+        return 1;
+    }
+    Log::setLevel(logLevel);
+
+    vector<Scenario> scenarios;
+    if (!readManifest(manifestPath, scenarios)) {
+        std::cerr << "Error: cannot read manifest " << manifestPath << std::endl;
+        Log::shutdown();
+        return 1;
+    }
+    std::ofstream csvFile;
+    if (csvPath != "-") {
+        csvFile.open(csvPath);
+        if (!csvFile.is_open()) {
+            std::cerr << "Error: cannot write " << csvPath << std::endl;
+            Log::shutdown();
+            return 1;
+        }
+    }
+
+    vector<ScenarioResult> results(scenarios.size());
+    auto start = std::chrono::steady_clock::now();
+    {
+        ThreadPool pool(numThreads);
+        pool.parallelFor(scenarios.size(), 1, [&](int begin, int end) {
+            for (int i = begin; i < end; i++) {
+                runScenario(i, scenarios[i], outputDir, results[i]);
+            }
+        });
+    }
+    double seconds = secondsSince(start);
+
+    std::ostream &csv = csvFile.is_open() ? static_cast<std::ostream&>(csvFile) : std::cout;
+    csv << "scenario,config,script,status,load_seconds,run_seconds,commands,errors,ticks,plans,life_quality,economy,environment\n";
+    char timings[64];
+    for (size_t i = 0; i < scenarios.size(); i++) {
+        const ScenarioResult &result = results[i];
+        std::snprintf(timings, sizeof(timings), "%.6f,%.6f", result.loadSeconds, result.runSeconds);
+        csv << i << ',' << csvField(scenarios[i].configPath) << ',' << csvField(scenarios[i].scriptPath) << ',' << csvField(result.status) << ','
+            << timings << ',' << result.numCommands << ',' << result.numErrors << ',' << result.ticks << ',' << result.totals.numPlans << ','
+            << result.totals.lifeQualityScore << ',' << result.totals.economyScore << ',' << result.totals.environmentScore << '\n';
+    }
+    csv.flush();
+    std::cerr << "Ran " << scenarios.size() << " scenarios on " << numThreads << " threads in " << seconds << " s" << std::endl;
+    Log::shutdown();
+    return 0;
+}
@@ -0,0 +1,359 @@
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+using std::string;
+using std::vector;
+
+/*
+Synthetic world generator for scaling tests. Writes a configuration file in the settlement /
+facility / plan grammar of test.txt and, optionally, a command script for bin/main --script.
+
+    --seed N              generation is a pure function of the seed and the options below
+    --settlements N       number of settlements (named Settlement0, Settlement1, ...)
+    --settlement-mix MIX  weights of the settlement types, village:5,city:3,metropolis:2
+    --facilities N        catalog size (named Facility0, Facility1, ...)
+    --category-mix MIX    weights of the facility categories, life:1,economy:1,environment:1
+    --plans N             number of plans, on settlements picked at random (default: one each)
+    --policy-mix MIX      weights of the plan policies, nve:1,bal:1,eco:1,sus:1
+    --commands N          length of the command script, ended by close
+    --command-mix MIX     weights of the commands, step:4,planStatus:4,changePolicy:2,log:1,backup:0,restore:0
+    --max-step N          step sizes are drawn from 1..N
+    --hot PERCENT         share of plan commands aimed at the first 1% of the plans
+    --invalid PERCENT     share of plan commands naming a plan or policy that does not exist
+    --config FILE         configuration output, - for stdout (the default)
+    --script FILE         command script output, - for stdout
+
+Lines are generated one at a time into a fixed buffer, so output size is bounded only by the
+disk. The configuration and the script draw from separate streams of the seed, so changing the
+command options does not change the world they run against.
+*/
+
+static const size_t BUFFER_BYTES = 1 << 20;
+
+// Buffered line output; the buffer is written out whenever it fills up
+class Output {
+    public:
+        Output() : file(nullptr) {}
+        ~Output() {
+            close();
+        }
+        bool open(const string &path) {
+            file = path == "-" ? stdout : std::fopen(path.c_str(), "w");
+            buffer.reserve(BUFFER_BYTES + 256);
+            return file != nullptr;
+        }
+        Output &operator<<(const char *text) {
+            buffer += text;
+            return *this;
+        }
+        Output &operator<<(const string &text) {
+            buffer += text;
+            return *this;
+        }
+        Output &operator<<(long long number) {
+            char digits[24];
+            buffer.append(digits, std::to_chars(digits, digits + sizeof(digits), number).ptr - digits);
+            return *this;
+        }
+        void endLine() {
+            buffer += '\n';
+            if (buffer.size() >= BUFFER_BYTES) {
+                flush();
+            }
+        }
+        bool close() {
+            if (file == nullptr) {
+                return true;
+            }
+            flush();
+            bool written = !std::ferror(file) && (file == stdout ? std::fflush(file) == 0 : std::fclose(file) == 0);
+            file = nullptr;
+            return written;
+        }
+
+    private:
+        void flush() {
+            std::fwrite(buffer.data(), 1, buffer.size(), file);
+            buffer.clear();
+        }
+        FILE *file;
+        string buffer;
+};
+
+// SplitMix64: the same sequence on every platform, unlike the std distributions
+class Random {
+    public:
+        explicit Random(uint64_t seed) : state(seed) {}
+        uint64_t next() {
+            uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+        long long below(long long bound) { //Uniform in [0, bound)
+            return (long long)(((unsigned __int128)next() * (uint64_t)bound) >> 64);
+        }
+        bool percent(int chance) {
+            return below(100) < chance;
+        }
+
+    private:
+        uint64_t state;
+};
+
+// Named weights, parsed from name:weight,name:weight; names left out weigh 0
+struct Mix {
+    vector<string> names;
+    vector<long long> weights;
+    long long total;
+
+    Mix(std::initializer_list<std::pair<const char*, long long>> defaults) : total(0) {
+        for (const auto &entry : defaults) {
+            names.push_back(entry.first);
+            weights.push_back(entry.second);
+            total += entry.second;
+        }
+    }
+
+    bool parse(const string &text) {
+        vector<long long> parsed(names.size(), 0);
+        size_t position = 0;
+        while (position <= text.size()) {
+            size_t end = text.find(',', position);
+            end = end == string::npos ? text.size() : end;
+            string entry = text.substr(position, end - position);
+            size_t colon = entry.find(':');
+            size_t index = 0;
+            while (index < names.size() && (colon == string::npos || entry.compare(0, colon, names[index]) != 0)) {
+                index++;
+            }
+            char *numberEnd;
+            long long weight = colon == string::npos ? -1 : std::strtoll(entry.c_str() + colon + 1, &numberEnd, 10);
+            if (index == names.size() || weight < 0 || *numberEnd != '\0') {
+                return false;
+            }
+            parsed[index] = weight;
+            position = end + 1;
+        }
+        long long sum = 0;
+        for (long long weight : parsed) {
+            sum += weight;
+        }
+        if (sum == 0) {
+            return false;
+        }
+        weights.swap(parsed);
+        total = sum;
+        return true;
+    }
+
+    int pick(Random &random) const {
+        long long point = random.below(total);
+        int index = 0;
+        while (point >= weights[index]) {
+            point -= weights[index++];
+        }
+        return index;
+    }
+
+    string toString() const {
+        string text;
+        for (size_t i = 0; i < names.size(); i++) {
+            text += (i == 0 ? "" : ",") + names[i] + ":" + std::to_string(weights[i]);
+        }
+        return text;
+    }
+};
+
+enum Command { STEP, PLAN_STATUS, CHANGE_POLICY, LOG, BACKUP, RESTORE };
+
+struct Options {
+    uint64_t seed = 1;
+    long long numSettlements = 1000;
+    long long numFacilities = 100;
+    long long numPlans = -1; //One per settlement
+    long long numCommands = 0;
+    long long maxStep = 5;
+    int hotPercent = 0;
+    int invalidPercent = 0;
+    string configPath = "-";
+    string scriptPath;
+    Mix settlementMix{{"village", 5}, {"city", 3}, {"metropolis", 2}};
+    Mix categoryMix{{"life", 1}, {"economy", 1}, {"environment", 1}};
+    Mix policyMix{{"nve", 1}, {"bal", 1}, {"eco", 1}, {"sus", 1}};
+    Mix commandMix{{"step", 4}, {"planStatus", 4}, {"changePolicy", 2}, {"log", 1}, {"backup", 0}, {"restore", 0}};
+};
+
+static string describe(const Options &options) {
+    return "--seed " + std::to_string(options.seed) + " --settlements " + std::to_string(options.numSettlements)
+           + " --settlement-mix " + options.settlementMix.toString() + " --facilities " + std::to_string(options.numFacilities)
+           + " --category-mix " + options.categoryMix.toString() + " --plans " + std::to_string(options.numPlans)
+           + " --policy-mix " + options.policyMix.toString();
+}
+
+static void writeConfig(const Options &options, Output &out) {
+    Random random(options.seed);
+    out << "# bin/generate " << describe(options);
+    out.endLine();
+    out << "# settlement <settlement_name> <settlement_type>";
+    out.endLine();
+    for (long long i = 0; i < options.numSettlements; i++) {
+        out << "settlement Settlement" << i << " " << (long long)options.settlementMix.pick(random);
+        out.endLine();
+    }
+    out << "# facility <facility_name> <category> <price> <lifeq_impact> <eco_impact> <env_impact>";
+    out.endLine();
+    for (long long i = 0; i < options.numFacilities; i++) {
+        int category = options.categoryMix.pick(random);
+        // The category's own score leads, as in the sample catalog
+        long long scores[3] = {random.below(4), random.below(4), random.below(4)};
+        scores[category] += 2;
+        out << "facility Facility" << i << " " << (long long)category << " " << random.below(5) + 1 << " "
+            << scores[0] << " " << scores[1] << " " << scores[2];
+        out.endLine();
+    }
+    out << "# plan <settlement_name> <selection_policy>";
+    out.endLine();
+    for (long long i = 0; i < options.numPlans; i++) {
+        long long settlement = options.numPlans == options.numSettlements ? i : random.below(options.numSettlements);
+        out << "plan Settlement" << settlement << " " << options.policyMix.names[options.policyMix.pick(random)];
+        out.endLine();
+    }
+}
+
+static long long pickPlan(const Options &options, Random &random) {
+    if (random.percent(options.invalidPercent)) {
+        return options.numPlans + random.below(options.numPlans + 1);
+    }
+    long long hotPlans = options.numPlans / 100 > 0 ? options.numPlans / 100 : 1;
+    return random.percent(options.hotPercent) ? random.below(hotPlans) : random.below(options.numPlans);
+}
+
+static void writeScript(const Options &options, Output &out) {
+    Random random(options.seed ^ 0x5c1219700d5eedULL); //Independent of the configuration's stream
+    for (long long i = 0; i < options.numCommands; i++) {
+        switch (options.commandMix.pick(random)) {
+            case STEP:
+                out << "step " << random.below(options.maxStep) + 1;
+                break;
+            case PLAN_STATUS:
+                out << "planStatus " << pickPlan(options, random);
+                break;
+            case CHANGE_POLICY: {
+                long long plan = pickPlan(options, random);
+                const string &policy = options.policyMix.names[options.policyMix.pick(random)];
+                // changePolicy calls the sustainability policy env where plan lines call it sus
+                out << "changePolicy " << plan << " " << (random.percent(options.invalidPercent) ? "xyz" : policy == "sus" ? "env" : policy);
+                break;
+            }
+            case LOG:
+                out << "log -" << random.below(10) + 1 << " 10";
+                break;
+            case BACKUP:
+                out << "backup";
+                break;
+            case RESTORE:
+                out << "restore";
+                break;
+        }
+        out.endLine();
+    }
+    out << "close";
+    out.endLine();
+}
+
+static bool parseCount(const char *text, long long minimum, long long &count) {
+    char *end;
+    count = std::strtoll(text, &end, 10);
+    return *text != '\0' && *end == '\0' && count >= minimum;
+}
+
+int main(int argc, char** argv) {
+    const char *usage = "usage: generate [--seed N] [--settlements N] [--settlement-mix MIX] [--facilities N] [--category-mix MIX] "
+                        "[--plans N] [--policy-mix MIX] [--commands N] [--command-mix MIX] [--max-step N] [--hot PERCENT] "
+                        "[--invalid PERCENT] [--config FILE] [--script FILE]";
+    Options options;
+    long long number;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (i + 1 == argc) { //Every option takes a value
+            fprintf(stderr, "%s\n", usage);
+            return 1;
+        }
+        const char *value = argv[++i];
+        bool valid = true;
+        if (arg == "--seed") {
+            valid = parseCount(value, 0, number);
+            options.seed = number;
+        } else if (arg == "--settlements") {
+            valid = parseCount(value, 1, options.numSettlements);
+        } else if (arg == "--facilities") {
+            valid = parseCount(value, 1, options.numFacilities);
+        } else if (arg == "--plans") {
+            valid = parseCount(value, 0, options.numPlans);
+        } else if (arg == "--commands") {
+            valid = parseCount(value, 0, options.numCommands);
+        } else if (arg == "--max-step") {
+            valid = parseCount(value, 1, options.maxStep);
+        } else if (arg == "--hot") {
+            valid = parseCount(value, 0, number) && number <= 100;
+            options.hotPercent = number;
+        } else if (arg == "--invalid") {
+            valid = parseCount(value, 0, number) && number <= 100;
+            options.invalidPercent = number;
+        } else if (arg == "--settlement-mix") {
+            valid = options.settlementMix.parse(value);
+        } else if (arg == "--category-mix") {
+            valid = options.categoryMix.parse(value);
+        } else if (arg == "--policy-mix") {
+            valid = options.policyMix.parse(value);
+        } else if (arg == "--command-mix") {
+            valid = options.commandMix.parse(value);
+        } else if (arg == "--config") {
+            options.configPath = value;
+        } else if (arg == "--script") {
+            options.scriptPath = value;
+        } else {
+            valid = false;
+        }
+        if (!valid) {
+            fprintf(stderr, "%s\n", usage);
+            return 1;
+        }
+    }
+    if (options.numPlans == -1) {
+        options.numPlans = options.numSettlements;
+    }
+    if (options.numCommands > 0 && (options.scriptPath.empty() || options.numPlans == 0 || options.scriptPath == options.configPath)) {
+        fprintf(stderr, "Error: --commands needs --script FILE (other than the config output) and at least one plan\n");
+        return 1;
+    }
+
+    Output config;
+    if (!config.open(options.configPath)) {
+        fprintf(stderr, "Error: cannot create %s\n", options.configPath.c_str());
+        return 1;
+    }
+    writeConfig(options, config);
+    if (!config.close()) {
+        fprintf(stderr, "Error: failed writing %s\n", options.configPath.c_str());
+        return 1;
+    }
+    if (!options.scriptPath.empty()) {
+        Output script;
+        if (!script.open(options.scriptPath)) {
+            fprintf(stderr, "Error: cannot create %s\n", options.scriptPath.c_str());
+            return 1;
+        }
+        writeScript(options, script);
+        if (!script.close()) {
+            fprintf(stderr, "Error: failed writing %s\n", options.scriptPath.c_str());
+            return 1;
+        }
+    }
+    return 0;
+}